@@ -0,0 +1,242 @@
+/* Pool of alternate signal stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "altstack.h"
+
+#include <stdint.h>
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Windows has no alternate signal stacks.  The extra stack is only used for
+   running the stack overflow handler, and a block from the heap will do.  */
+
+#include <stdlib.h>
+
+#define STACK_SIZE 65536
+
+void *
+sigsegv_altstack_allocate (size_t *sizep)
+{
+  *sizep = STACK_SIZE;
+  return malloc (STACK_SIZE);
+}
+
+void
+sigsegv_altstack_release (void *stack)
+{
+  free (stack);
+}
+
+#else
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if !(HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS)
+# include <fcntl.h>
+#endif
+#if HAVE_SYS_AUXV_H
+# include <sys/auxv.h>
+#endif
+
+#include "atomic.h"
+
+/* DragonFly BSD 3.8 still has only MAP_ANON and not MAP_ANONYMOUS.  */
+#if HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#ifndef MINSIGSTKSZ
+# define MINSIGSTKSZ 2048
+#endif
+
+/* The stack space needed by the handlers, in addition to the space that
+   the kernel needs for delivering a signal.  This covers the fault handler
+   of libsigsegv, including the reading of the memory map, and a stack
+   overflow handler of moderate size.  */
+#define HANDLER_STACK_SIZE 32768
+
+/* The stacks are carved out of slabs of this many stacks, each of which is
+   preceded and followed by a guard page:
+     guard, stack, guard, stack, ..., stack, guard
+   A stack that is no longer used goes to a free list; the first word of
+   its memory points to the next free stack.  Its pages are given back to
+   the system, except for this first one.  */
+#define SLAB_STACKS 16
+
+static size_t pagesize;
+/* The size of each stack, a multiple of pagesize.  */
+static size_t stack_size;
+
+/* The stacks that were released.  */
+static void *free_stacks;
+/* The stacks of the current slab that were never used.  */
+static char *slab_next;
+static unsigned int slab_left;
+
+/* A spin lock that protects the variables above.  */
+static volatile unsigned int pool_lock;
+
+static void
+lock_pool (void)
+{
+  while (!sv_atomic_compare_and_swap (&pool_lock, 0, 1))
+    ;
+}
+
+static void
+unlock_pool (void)
+{
+  sv_atomic_store (&pool_lock, 0);
+}
+
+/* Determines pagesize and stack_size.  */
+static void
+init_sizes (void)
+{
+  size_t min_size = MINSIGSTKSZ;
+
+#if HAVE_GETPAGESIZE
+  pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+  pagesize = sysconf (_SC_PAGESIZE);
+#else
+  pagesize = PAGESIZE;
+#endif
+#if HAVE_GETAUXVAL && defined AT_MINSIGSTKSZ
+  /* The kernel tells how much room a signal frame needs on this machine,
+     which depends on the size of the vector registers.  */
+  {
+    unsigned long kernel_size = getauxval (AT_MINSIGSTKSZ);
+    if (kernel_size > min_size)
+      min_size = kernel_size;
+  }
+#endif
+  stack_size = (min_size + HANDLER_STACK_SIZE + pagesize - 1) & -pagesize;
+}
+
+/* Allocates a new slab, with its guard pages.  Returns it, or NULL.
+   Called without the lock held.  */
+static char *
+new_slab (void)
+{
+  size_t slot_size = pagesize + stack_size;
+  size_t slab_size = SLAB_STACKS * slot_size + pagesize;
+  char *slab;
+  unsigned int i;
+
+#if HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS
+  slab = (char *) mmap (NULL, slab_size, PROT_READ | PROT_WRITE,
+                        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+#else
+  {
+    int fd = open ("/dev/zero", O_RDONLY, 0644);
+    if (fd < 0)
+      return NULL;
+    slab = (char *) mmap (NULL, slab_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+    close (fd);
+  }
+#endif
+  if (slab == (char *) (void *) -1)
+    return NULL;
+  for (i = 0; i <= SLAB_STACKS; i++)
+    if (mprotect (slab + i * slot_size, pagesize, PROT_NONE) < 0)
+      {
+        munmap (slab, slab_size);
+        return NULL;
+      }
+  sigsegv_vma_snapshot_invalidate ();
+  return slab;
+}
+
+void *
+sigsegv_altstack_allocate (size_t *sizep)
+{
+  void *stack;
+  char *slab = NULL;
+  int failed = 0;
+
+  lock_pool ();
+  if (stack_size == 0)
+    init_sizes ();
+  for (;;)
+    {
+      if (free_stacks != NULL)
+        {
+          stack = free_stacks;
+          free_stacks = *(void **) stack;
+          break;
+        }
+      if (slab_left > 0)
+        {
+          stack = slab_next;
+          slab_next += pagesize + stack_size;
+          slab_left--;
+          break;
+        }
+      if (slab != NULL)
+        {
+          /* Publish the slab that we allocated.  */
+          slab_next = slab + pagesize;
+          slab_left = SLAB_STACKS;
+          slab = NULL;
+          continue;
+        }
+      if (failed)
+        {
+          stack = NULL;
+          break;
+        }
+      /* Allocate a slab without holding the lock: it takes many system
+         calls.  */
+      unlock_pool ();
+      slab = new_slab ();
+      lock_pool ();
+      if (slab == NULL)
+        failed = 1;
+    }
+  unlock_pool ();
+  if (slab != NULL)
+    {
+      /* Another thread provided a stack in the meantime.  */
+      munmap (slab, SLAB_STACKS * (pagesize + stack_size) + pagesize);
+      sigsegv_vma_snapshot_invalidate ();
+    }
+  *sizep = stack_size;
+  return stack;
+}
+
+void
+sigsegv_altstack_release (void *stack)
+{
+  if (stack == NULL)
+    return;
+#if HAVE_MADVISE && defined MADV_DONTNEED
+  /* Give the memory back to the system.  */
+  madvise ((char *) stack + pagesize, stack_size - pagesize, MADV_DONTNEED);
+#endif
+  lock_pool ();
+  *(void **) stack = free_stacks;
+  free_stacks = stack;
+  unlock_pool ();
+}
+
+#endif
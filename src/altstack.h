@@ -0,0 +1,31 @@
+/* Pool of alternate signal stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _ALTSTACK_H
+#define _ALTSTACK_H
+
+#include <stddef.h>
+
+/* Allocates an alternate stack, surrounded by inaccessible guard pages.
+   Returns its start address and stores its size in *SIZEP, or returns NULL
+   upon failure.  */
+extern void *sigsegv_altstack_allocate (size_t *sizep);
+
+/* Returns an alternate stack, allocated by sigsegv_altstack_allocate, to the
+   pool.  The stack must no longer be in use by any thread.  */
+extern void sigsegv_altstack_release (void *stack);
+
+#endif /* _ALTSTACK_H */
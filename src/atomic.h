@@ -0,0 +1,68 @@
+/* Atomic operations, usable from signal handlers.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _ATOMIC_H
+#define _ATOMIC_H
+
+/* The operations work on naturally aligned 'unsigned int', 'uintptr_t' and
+   'unsigned long long' variables, which should be declared 'volatile'.
+
+     sv_atomic_load (P)             loads *P, with acquire semantics.
+     sv_atomic_store (P, V)         stores V into *P, with release semantics.
+     sv_atomic_fetch_add (P, V)     adds V to *P, returns the old value.
+     sv_atomic_compare_and_swap (P, OLD, NEW)
+                                    stores NEW into *P if *P == OLD,
+                                    returns nonzero if it did so.
+
+   Without compiler support, they degrade to plain memory accesses, which is
+   only correct in single-threaded programs.  */
+
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7) || defined __clang__
+
+# define sv_atomic_load(p) \
+   __atomic_load_n (p, __ATOMIC_ACQUIRE)
+# define sv_atomic_store(p,v) \
+   __atomic_store_n (p, v, __ATOMIC_RELEASE)
+# define sv_atomic_fetch_add(p,v) \
+   __atomic_fetch_add (p, v, __ATOMIC_SEQ_CST)
+# define sv_atomic_compare_and_swap(p,old,new) \
+   __sync_bool_compare_and_swap (p, old, new)
+
+#elif __GNUC__ >= 4
+
+# define sv_atomic_load(p) \
+   (__sync_synchronize (), *(p))
+# define sv_atomic_store(p,v) \
+   (__sync_synchronize (), *(p) = (v), __sync_synchronize ())
+# define sv_atomic_fetch_add(p,v) \
+   __sync_fetch_and_add (p, v)
+# define sv_atomic_compare_and_swap(p,old,new) \
+   __sync_bool_compare_and_swap (p, old, new)
+
+#else
+
+# define sv_atomic_load(p) \
+   (*(p))
+# define sv_atomic_store(p,v) \
+   (*(p) = (v))
+# define sv_atomic_fetch_add(p,v) \
+   ((*(p) += (v)) - (v))
+# define sv_atomic_compare_and_swap(p,old,new) \
+   (*(p) == (old) ? (*(p) = (new), 1) : 0)
+
+#endif
+
+#endif /* _ATOMIC_H */
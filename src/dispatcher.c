@@ -15,6 +15,7 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "sigsegv.h"
+#include "dispatcher.h"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -39,6 +40,8 @@ struct node_t
   /* User handler.  */
   sigsegv_area_handler_t handler;
   void *handler_arg;
+  /* SIGSEGV_AREA_* flags.  */
+  int flags;
 }
 node_t;
 
@@ -208,9 +211,21 @@ void *
 sigsegv_register (sigsegv_dispatcher *dispatcher,
                   void *address, size_t len,
                   sigsegv_area_handler_t handler, void *handler_arg)
+{
+  return sigsegv_register_flags (dispatcher, address, len,
+                                 handler, handler_arg, 0);
+}
+
+void *
+sigsegv_register_flags (sigsegv_dispatcher *dispatcher,
+                        void *address, size_t len,
+                        sigsegv_area_handler_t handler, void *handler_arg,
+                        int flags)
 {
   if (len == 0)
     return NULL;
+  else if ((flags & SIGSEGV_AREA_SINGLESTEP) && sigsegv_singlestep_init () < 0)
+    return NULL;
   else
     {
       node_t *new_node = (node_t *) malloc (sizeof (node_t));
@@ -218,6 +233,7 @@ sigsegv_register (sigsegv_dispatcher *dispatcher,
       new_node->len = len;
       new_node->handler = handler;
       new_node->handler_arg = handler_arg;
+      new_node->flags = flags;
       dispatcher->tree = insert (new_node, (node_t *) dispatcher->tree);
       return new_node;
     }
@@ -234,21 +250,50 @@ sigsegv_unregister (sigsegv_dispatcher *dispatcher, void *ticket)
     }
 }
 
-int
-sigsegv_dispatch (sigsegv_dispatcher *dispatcher, void *fault_address)
+/* Returns the node whose interval contains ADDRESS, or empty.  */
+static node_t *
+find (node_t *tree, uintptr_t key)
 {
-  uintptr_t key = (uintptr_t) fault_address;
-  node_t *tree = (node_t *) dispatcher->tree;
   for (;;)
     {
       if (tree == empty)
-        return 0;
+        return empty;
       if (key < tree->address)
         tree = tree->left;
       else if (key - tree->address >= tree->len)
         tree = tree->right;
       else
-        break;
+        return tree;
+    }
+}
+
+int
+sigsegv_dispatcher_lookup (sigsegv_dispatcher *dispatcher, void *address,
+                           sigsegv_area_handler_t *handlerp,
+                           void **handler_argp)
+{
+  node_t *node = find ((node_t *) dispatcher->tree, (uintptr_t) address);
+  if (node == empty)
+    return 0;
+  *handlerp = node->handler;
+  *handler_argp = node->handler_arg;
+  return 1;
+}
+
+int
+sigsegv_dispatch (sigsegv_dispatcher *dispatcher, void *fault_address)
+{
+  node_t *node = find ((node_t *) dispatcher->tree, (uintptr_t) fault_address);
+  if (node == empty)
+    return 0;
+  if (node->flags & SIGSEGV_AREA_SINGLESTEP)
+    {
+      if (!(*node->handler) (fault_address, node->handler_arg))
+        return 0;
+      /* Let the faulting instruction execute, then protect the page
+         again.  */
+      return sigsegv_singlestep (fault_address,
+                                 node->flags & SIGSEGV_AREA_READONLY) == 0;
     }
-  return (*tree->handler) (fault_address, tree->handler_arg);
+  return (*node->handler) (fault_address, node->handler_arg);
 }
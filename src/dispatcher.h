@@ -0,0 +1,43 @@
+/* Dispatch signal to right virtual memory area.  Internal interface.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _DISPATCHER_H
+#define _DISPATCHER_H
+
+/* Looks up the interval that contains ADDRESS.  If found, stores its handler
+   and handler argument in *HANDLERP and *HANDLER_ARGP and returns 1.
+   Otherwise returns 0.
+   This permits to use a sigsegv_dispatcher as an interval table for other
+   data, such as handlers of another type, stored in the handler argument.  */
+extern int sigsegv_dispatcher_lookup (sigsegv_dispatcher *dispatcher,
+                                      void *address,
+                                      sigsegv_area_handler_t *handlerp,
+                                      void **handler_argp);
+
+/* Prepares for single-stepping of faulting instructions.  Called outside of
+   signal handlers.  Returns 0 if single-stepping is supported, or -1.
+   Implemented by the handler.  */
+extern int sigsegv_singlestep_init (void);
+
+/* Called from a SIGSEGV handler.  Makes the page containing FAULT_ADDRESS
+   accessible and arranges for the faulting instruction to be executed in
+   single-step mode, after which the page is protected again: with PROT_READ
+   if READONLY is nonzero, or with PROT_NONE otherwise.
+   Returns 0 upon success, or -1 upon failure.
+   Implemented by the handler.  */
+extern int sigsegv_singlestep (void *fault_address, int readonly);
+
+#endif /* _DISPATCHER_H */
@@ -0,0 +1,305 @@
+/* Decoding and emulation of faulting memory accesses.  Linux/x86_64 version.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* This file is included by handler-unix.c.  It decodes the instructions
+   that move data between memory and a general-purpose register or an
+   immediate:
+     88 /r        MOV r/m8, r8
+     89 /r        MOV r/m16/32/64, r16/32/64
+     8A /r        MOV r8, r/m8
+     8B /r        MOV r16/32/64, r/m16/32/64
+     C6 /0 ib     MOV r/m8, imm8
+     C7 /0 iw/id  MOV r/m16/32/64, imm16/32
+     0F B6 /r     MOVZX r, r/m8
+     0F B7 /r     MOVZX r, r/m16
+     0F BE /r     MOVSX r, r/m8
+     0F BF /r     MOVSX r, r/m16
+     63 /r        MOVSXD r64, r/m32
+   with the operand-size prefix 66 and a REX prefix.  Instructions with a
+   FS or GS segment override, an address-size override, or a LOCK or REP
+   prefix are rejected.  */
+
+#include <string.h>
+
+/* Values of the 'extension' field of a sigsegv_access.  */
+enum
+{
+  EXTEND_NONE,          /* plain MOV */
+  EXTEND_ZERO,          /* MOVZX */
+  EXTEND_SIGN           /* MOVSX, MOVSXD */
+};
+
+/* Maps the register numbers of the instruction encoding to indices in the
+   gregs array of the mcontext_t.  */
+static const int gregs_index[16] =
+  {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15
+  };
+
+/* For 8-bit operands without a REX prefix, register numbers 4..7 designate
+   AH, CH, DH, BH.  We represent them as 16..19.  */
+#define REG_HIGH_BYTE 16
+
+static unsigned long long
+read_reg (greg_t *gregs, int reg, size_t size)
+{
+  unsigned long long value;
+
+  if (reg >= REG_HIGH_BYTE)
+    return ((unsigned long long) gregs[gregs_index[reg - REG_HIGH_BYTE]]
+            >> 8) & 0xff;
+  value = (unsigned long long) gregs[gregs_index[reg]];
+  if (size < 8)
+    value &= (1ULL << (8 * size)) - 1;
+  return value;
+}
+
+static void
+write_reg (greg_t *gregs, int reg, size_t size, unsigned long long value)
+{
+  greg_t *p;
+  unsigned long long old;
+
+  if (reg >= REG_HIGH_BYTE)
+    {
+      p = &gregs[gregs_index[reg - REG_HIGH_BYTE]];
+      old = (unsigned long long) *p;
+      *p = (greg_t) ((old & ~0xff00ULL) | ((value & 0xff) << 8));
+      return;
+    }
+  p = &gregs[gregs_index[reg]];
+  old = (unsigned long long) *p;
+  switch (size)
+    {
+    case 1:
+      *p = (greg_t) ((old & ~0xffULL) | (value & 0xff));
+      break;
+    case 2:
+      *p = (greg_t) ((old & ~0xffffULL) | (value & 0xffff));
+      break;
+    case 4:
+      /* A 32-bit destination is zero-extended to 64 bits.  */
+      *p = (greg_t) (value & 0xffffffffULL);
+      break;
+    default:
+      *p = (greg_t) value;
+      break;
+    }
+}
+
+/* Reads a little-endian signed integer of SIZE bytes at P.  */
+static long long
+read_signed (const unsigned char *p, size_t size)
+{
+  switch (size)
+    {
+    case 1:
+      return (signed char) p[0];
+    case 2:
+      return (short) (p[0] | (p[1] << 8));
+    default:
+      return (int) ((unsigned int) p[0] | ((unsigned int) p[1] << 8)
+                    | ((unsigned int) p[2] << 16) | ((unsigned int) p[3] << 24));
+    }
+}
+
+static int
+decode_access (stackoverflow_context_t context, sigsegv_access *access)
+{
+  greg_t *gregs = ((ucontext_t *) context)->uc_mcontext.gregs;
+  const unsigned char *start = (const unsigned char *) gregs[REG_RIP];
+  const unsigned char *p = start;
+  int opsize_prefix = 0;
+  int rex = 0;
+  int opcode;
+  int is_write;
+  int extension = EXTEND_NONE;
+  size_t size;            /* size of the memory operand */
+  size_t reg_size;        /* size of the register operand */
+  size_t imm_size = 0;
+  int modrm, mod, reg, rm;
+  int rip_relative = 0;
+  unsigned long long ea = 0;
+  long long disp = 0;
+
+  /* Legacy prefixes.  */
+  for (;; p++)
+    {
+      if (p - start >= 4)
+        return -1;
+      if (*p == 0x66)
+        opsize_prefix = 1;
+      else if (*p == 0x2e || *p == 0x36 || *p == 0x3e || *p == 0x26)
+        /* Segment overrides without effect in 64-bit mode.  */
+        ;
+      else
+        break;
+    }
+  /* REX prefix.  */
+  if ((*p & 0xf0) == 0x40)
+    rex = *p++;
+
+  /* Opcode.  */
+  opcode = *p++;
+  if (opcode == 0x0f)
+    opcode = 0x0f00 | *p++;
+  switch (opcode)
+    {
+    case 0x88: case 0x8a:
+      is_write = (opcode == 0x88);
+      size = reg_size = 1;
+      break;
+    case 0x89: case 0x8b:
+      is_write = (opcode == 0x89);
+      size = reg_size = (rex & 8 ? 8 : opsize_prefix ? 2 : 4);
+      break;
+    case 0xc6:
+      is_write = 1;
+      size = reg_size = imm_size = 1;
+      break;
+    case 0xc7:
+      is_write = 1;
+      size = reg_size = (rex & 8 ? 8 : opsize_prefix ? 2 : 4);
+      imm_size = (opsize_prefix && !(rex & 8) ? 2 : 4);
+      break;
+    case 0x0fb6: case 0x0fb7: case 0x0fbe: case 0x0fbf:
+      is_write = 0;
+      size = (opcode & 1 ? 2 : 1);
+      reg_size = (rex & 8 ? 8 : opsize_prefix ? 2 : 4);
+      extension = (opcode & 8 ? EXTEND_SIGN : EXTEND_ZERO);
+      break;
+    case 0x63:
+      is_write = 0;
+      size = 4;
+      reg_size = (rex & 8 ? 8 : 4);
+      extension = (rex & 8 ? EXTEND_SIGN : EXTEND_NONE);
+      break;
+    default:
+      return -1;
+    }
+
+  /* ModR/M byte.  */
+  modrm = *p++;
+  mod = modrm >> 6;
+  reg = ((modrm >> 3) & 7) | (rex & 4 ? 8 : 0);
+  rm = modrm & 7;
+  if (mod == 3)
+    /* Register operand, not a memory access.  */
+    return -1;
+  if (imm_size > 0 && (reg & 7) != 0)
+    return -1;
+  if (rm == 4)
+    {
+      /* SIB byte.  */
+      int sib = *p++;
+      int scale = sib >> 6;
+      int index = ((sib >> 3) & 7) | (rex & 2 ? 8 : 0);
+      int base = (sib & 7) | (rex & 1 ? 8 : 0);
+
+      if (index != 4)
+        ea += (unsigned long long) gregs[gregs_index[index]] << scale;
+      if ((base & 7) == 5 && mod == 0)
+        {
+          disp = read_signed (p, 4);
+          p += 4;
+        }
+      else
+        ea += (unsigned long long) gregs[gregs_index[base]];
+    }
+  else if (rm == 5 && mod == 0)
+    {
+      rip_relative = 1;
+      disp = read_signed (p, 4);
+      p += 4;
+    }
+  else
+    ea += (unsigned long long) gregs[gregs_index[rm | (rex & 1 ? 8 : 0)]];
+  if (mod == 1)
+    {
+      disp = read_signed (p, 1);
+      p += 1;
+    }
+  else if (mod == 2)
+    {
+      disp = read_signed (p, 4);
+      p += 4;
+    }
+  ea += (unsigned long long) disp;
+
+  /* Value to store.  */
+  if (imm_size > 0)
+    {
+      unsigned long long imm = (unsigned long long) read_signed (p, imm_size);
+      p += imm_size;
+      access->value =
+        (size < 8 ? imm & ((1ULL << (8 * size)) - 1) : imm);
+    }
+  else
+    {
+      if (reg_size == 1 && rex == 0 && reg >= 4)
+        reg = REG_HIGH_BYTE + (reg - 4);
+      access->value = (is_write ? read_reg (gregs, reg, size) : 0);
+    }
+
+  if (rip_relative)
+    /* Relative to the address of the next instruction.  */
+    ea += (unsigned long long) p;
+
+  access->address = (void *) ea;
+  access->size = size;
+  access->is_write = is_write;
+  access->context = context;
+  access->reg = reg;
+  access->extension = extension;
+  access->reg_size = reg_size;
+  access->length = p - start;
+  return 0;
+}
+
+static void
+complete_access (const sigsegv_access *access, unsigned long long value)
+{
+  greg_t *gregs = ((ucontext_t *) access->context)->uc_mcontext.gregs;
+
+  if (!access->is_write)
+    {
+      size_t size = access->size;
+
+      if (size < 8)
+        {
+          value &= (1ULL << (8 * size)) - 1;
+          if (access->extension == EXTEND_SIGN
+              && (value & (1ULL << (8 * size - 1))))
+            value |= ~((1ULL << (8 * size)) - 1);
+        }
+      write_reg (gregs, access->reg, access->reg_size, value);
+    }
+  gregs[REG_RIP] += access->length;
+}
+
+static void
+emulate_access (const sigsegv_access *access, void *shadow)
+{
+  unsigned long long value = 0;
+
+  /* x86 is little-endian: the low-order bytes come first.  */
+  if (access->is_write)
+    memcpy (shadow, &access->value, access->size);
+  else
+    memcpy (&value, shadow, access->size);
+  complete_access (access, value);
+}
@@ -25,6 +25,7 @@
    are actually the same.  */
 
 #define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.sp
+#define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.pc
 
 #else /* 32-bit */
 
@@ -37,5 +38,6 @@
    are actually the same.  */
 
 #define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.arm_sp
+#define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.arm_pc
 
 #endif
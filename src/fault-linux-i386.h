@@ -31,6 +31,8 @@
    are effectively the same.  */
 
 # define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_RSP]
+# define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_RIP]
+# define SIGSEGV_FAULT_TRACE_FLAGS  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_EFL]
 
 #else
 /* 32 bit registers */
@@ -45,5 +47,10 @@
 
 # define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_ESP]
                     /* same value as ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_UESP] */
+# define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_EIP]
+# define SIGSEGV_FAULT_TRACE_FLAGS  ((ucontext_t *) ucp)->uc_mcontext.gregs[REG_EFL]
 
 #endif
+
+/* The TF bit of the EFLAGS register.  */
+#define SIGSEGV_FAULT_TRACE_BIT  0x100
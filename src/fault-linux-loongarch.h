@@ -22,3 +22,4 @@
    (see also <asm/sigcontext.h>) are effectively the same.  */
 
 #define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.__gregs[3]
+#define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.__pc
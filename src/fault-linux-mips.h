@@ -27,3 +27,4 @@
    are effectively the same.  */
 
 #define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.gregs[29]
+#define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.pc
@@ -26,3 +26,4 @@
    start with the same block of 32 general-purpose registers.  */
 
 #define SIGSEGV_FAULT_STACKPOINTER  ((ucontext_t *) ucp)->uc_mcontext.__gregs[REG_SP]
+#define SIGSEGV_FAULT_PROGRAM_COUNTER  ((ucontext_t *) ucp)->uc_mcontext.__gregs[REG_PC]
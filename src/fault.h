@@ -31,6 +31,15 @@
      SIGSEGV_FAULT_STACKPOINTER
           is a macro for fetching the stackpointer at the moment the fault
           occurred.
+
+     SIGSEGV_FAULT_PROGRAM_COUNTER
+          is a macro for fetching the program counter at the moment the
+          fault occurred.  It designates an lvalue, so that the handler can
+          also redirect execution.
+
+     SIGSEGV_FAULT_TRACE_FLAGS, SIGSEGV_FAULT_TRACE_BIT
+          designate the register, as an lvalue, and the bit in it that make
+          the processor trap after executing one instruction.
  */
 
 #include CFG_FAULT
@@ -16,6 +16,8 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "sigsegv.h"
+#include "dispatcher.h"
+#include "altstack.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -463,6 +465,76 @@ sigsegv_deinstall_handler (void)
   user_handler = (sigsegv_handler_t)NULL;
 }
 
+/* Safepoints are not supported: the faulting thread is suspended by the
+   kernel while our exception thread handles the fault, and the exception
+   thread cannot park it.  */
+
+void *
+sigsegv_safepoint_install (sigsegv_safepoint_handler_t handler)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_safepoint_deinstall (void)
+{
+}
+
+/* Traps are not supported: only EXC_BAD_ACCESS is caught.  */
+
+void *
+sigsegv_register_trap (void *pc, size_t len,
+                       sigsegv_trap_handler_t handler, void *handler_arg)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_unregister_trap (void *ticket)
+{
+}
+
+void *
+sigsegv_watch (void *address, size_t len, int flags,
+               sigsegv_watch_handler_t handler, void *handler_arg)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_unwatch (void *ticket)
+{
+}
+
+int
+sigsegv_singlestep_init (void)
+{
+  return -1;
+}
+
+int
+sigsegv_singlestep (void *fault_address, int readonly)
+{
+  return -1;
+}
+
+int
+sigsegv_decode_access (sigsegv_access *access)
+{
+  return -1;
+}
+
+void
+sigsegv_complete_access (const sigsegv_access *access,
+                         unsigned long long value)
+{
+}
+
+void
+sigsegv_emulate_access (const sigsegv_access *access, void *shadow)
+{
+}
+
 int
 sigsegv_leave_handler (void (*continuation) (void*, void*, void*),
                        void* cont_arg1, void* cont_arg2, void* cont_arg3)
@@ -559,6 +631,22 @@ stackoverflow_install_handler (stackoverflow_handler_t handler,
   if (mach_initialized < 0)
     return -1;
 
+  if (extra_stack == NULL)
+    {
+      /* Let libsigsegv provide the extra stack.  */
+      if (stk_extra_stack == 0)
+        {
+          extra_stack = sigsegv_altstack_allocate (&extra_stack_size);
+          if (extra_stack == NULL)
+            return -1;
+        }
+      else
+        {
+          extra_stack = (void *) stk_extra_stack;
+          extra_stack_size = stk_extra_stack_size;
+        }
+    }
+
   stk_user_handler = handler;
   stk_extra_stack = (uintptr_t) extra_stack;
   stk_extra_stack_size = extra_stack_size;
@@ -570,3 +658,58 @@ stackoverflow_deinstall_handler (void)
 {
   stk_user_handler = (stackoverflow_handler_t) NULL;
 }
+
+int
+stackoverflow_register_thread (void *extra_stack, size_t extra_stack_size)
+{
+  return -1;
+}
+
+void
+stackoverflow_unregister_thread (void)
+{
+}
+
+void *
+sigsegv_register_stack (void *lo, void *hi, size_t guard)
+{
+  return (void *) 0;
+}
+
+void *
+sigsegv_register_growable_stack (void *start, size_t size,
+                                 size_t initial_size, size_t chunk_size)
+{
+  return (void *) 0;
+}
+
+void *
+sigsegv_register_stack_zones (void *lo, void *hi,
+                              size_t yellow_size, size_t red_size,
+                              sigsegv_yellow_handler_t handler)
+{
+  return (void *) 0;
+}
+
+int
+sigsegv_stack_reguard (void *ticket)
+{
+  return -1;
+}
+
+size_t
+sigsegv_stack_size (void *ticket)
+{
+  return 0;
+}
+
+void
+sigsegv_unregister_stack (void *ticket)
+{
+}
+
+void *
+stackoverflow_overflowed_stack (void)
+{
+  return (void *) 0;
+}
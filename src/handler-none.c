@@ -15,6 +15,7 @@
    along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "sigsegv.h"
+#include "dispatcher.h"
 
 int
 sigsegv_install_handler (sigsegv_handler_t handler)
@@ -27,6 +28,70 @@ sigsegv_deinstall_handler (void)
 {
 }
 
+void *
+sigsegv_safepoint_install (sigsegv_safepoint_handler_t handler)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_safepoint_deinstall (void)
+{
+}
+
+void *
+sigsegv_register_trap (void *pc, size_t len,
+                       sigsegv_trap_handler_t handler, void *handler_arg)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_unregister_trap (void *ticket)
+{
+}
+
+void *
+sigsegv_watch (void *address, size_t len, int flags,
+               sigsegv_watch_handler_t handler, void *handler_arg)
+{
+  return (void *) 0;
+}
+
+void
+sigsegv_unwatch (void *ticket)
+{
+}
+
+int
+sigsegv_singlestep_init (void)
+{
+  return -1;
+}
+
+int
+sigsegv_singlestep (void *fault_address, int readonly)
+{
+  return -1;
+}
+
+int
+sigsegv_decode_access (sigsegv_access *access)
+{
+  return -1;
+}
+
+void
+sigsegv_complete_access (const sigsegv_access *access,
+                         unsigned long long value)
+{
+}
+
+void
+sigsegv_emulate_access (const sigsegv_access *access, void *shadow)
+{
+}
+
 int
 sigsegv_leave_handler (void (*continuation) (void*, void*, void*),
                        void* cont_arg1, void* cont_arg2, void* cont_arg3)
@@ -46,3 +111,58 @@ void
 stackoverflow_deinstall_handler (void)
 {
 }
+
+int
+stackoverflow_register_thread (void *extra_stack, size_t extra_stack_size)
+{
+  return -1;
+}
+
+void
+stackoverflow_unregister_thread (void)
+{
+}
+
+void *
+sigsegv_register_stack (void *lo, void *hi, size_t guard)
+{
+  return (void *) 0;
+}
+
+void *
+sigsegv_register_growable_stack (void *start, size_t size,
+                                 size_t initial_size, size_t chunk_size)
+{
+  return (void *) 0;
+}
+
+void *
+sigsegv_register_stack_zones (void *lo, void *hi,
+                              size_t yellow_size, size_t red_size,
+                              sigsegv_yellow_handler_t handler)
+{
+  return (void *) 0;
+}
+
+int
+sigsegv_stack_reguard (void *ticket)
+{
+  return -1;
+}
+
+size_t
+sigsegv_stack_size (void *ticket)
+{
+  return 0;
+}
+
+void
+sigsegv_unregister_stack (void *ticket)
+{
+}
+
+void *
+stackoverflow_overflowed_stack (void)
+{
+  return (void *) 0;
+}
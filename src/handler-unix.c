@@ -95,26 +95,390 @@
    Leaving a signal handler executing on the alternate stack.  */
 #include "leave.h"
 
+#if HAVE_PTHREAD_GETATTR_NP || HAVE_PTHREAD_KEY_CREATE
+# include <pthread.h>
+#endif
+
+/* On Linux, the top of the main thread's stack is known without reading the
+   memory map.  */
+#if defined __linux__ && STACK_DIRECTION < 0 && HAVE_GETRLIMIT
+# define HAVE_MAIN_STACK_TOP 1
+# include <string.h>
+# include <unistd.h>
+# if HAVE_SYS_AUXV_H
+#  include <sys/auxv.h>
+# endif
+#endif
+
+/* Alternate stacks allocated by libsigsegv.  */
+#include "altstack.h"
+#include "atomic.h"
+
+/* The stack of a thread and its alternate stack.  */
+struct stack_bounds
+{
 #if HAVE_STACKVMA
+  /* Address of the last byte belonging to the stack vma.  */
+  uintptr_t top;
+#endif
+  /* The guard area beyond the end of the stack, or an empty interval.  */
+  uintptr_t guard_start;
+  uintptr_t guard_end;
+  /* Nonzero if the stack is mapped in its full size and cannot grow.  */
+  int fixed;
+  /* The alternate stack.  */
+  uintptr_t extra_stack;
+  size_t extra_stack_size;
+  /* Nonzero if the alternate stack was allocated by libsigsegv.  */
+  int pooled;
+};
+
+/* The bounds of the stack of the thread that called
+   stackoverflow_install_handler.  They are used for all threads that did not
+   call stackoverflow_register_thread.  */
+static struct stack_bounds process_stack;
+
+#if HAVE_THREAD_LOCAL
+/* The bounds of the stack of the current thread, if it called
+   stackoverflow_register_thread.  */
+static SV_THREAD_LOCAL struct stack_bounds thread_stack;
+#endif
 
-/* Address of the last byte belonging to the stack vma.  */
-static uintptr_t stack_top = 0;
+/* Returns the stack bounds that apply to the current thread.  */
+static struct stack_bounds *
+current_stack_bounds (void)
+{
+#if HAVE_THREAD_LOCAL
+  if (thread_stack.extra_stack != 0)
+    return &thread_stack;
+#endif
+  return &process_stack;
+}
 
-/* Needs to be called once only.  */
-static void
-remember_stack_top (void *some_variable_on_stack)
+/* Returns nonzero if ADDR is in the guard area of the stack BOUNDS.  */
+#define is_in_guard(addr, bounds) \
+  ((addr) - (bounds)->guard_start < (bounds)->guard_end - (bounds)->guard_start)
+
+#if HAVE_STACKVMA
+
+#if HAVE_MAIN_STACK_TOP
+
+# if HAVE___LIBC_STACK_END
+/* Set by the dynamic loader to the initial stack pointer of the main
+   thread, or just above it.  */
+extern void *__libc_stack_end;
+# endif
+
+/* If ADDR lies in the stack of the main thread, returns an address near the
+   top of that stack, and sets *MAX_SIZE to the stack size limit.  Otherwise
+   returns 0.  This does not read the memory map.  */
+static uintptr_t
+find_main_stack_top (uintptr_t addr, uintptr_t *max_size)
+{
+  uintptr_t top = 0;
+  struct rlimit rl;
+
+# if HAVE_GETAUXVAL && defined AT_EXECFN
+  /* The kernel puts the file name of the program at the very top of the
+     stack.  */
+  {
+    const char *execfn = (const char *) getauxval (AT_EXECFN);
+
+    if (execfn != NULL)
+      top = (uintptr_t) execfn + strlen (execfn);
+  }
+# endif
+# if HAVE___LIBC_STACK_END
+  if (top == 0)
+    top = (uintptr_t) __libc_stack_end;
+# endif
+  /* The stack of the main thread is at most RLIMIT_STACK large, and the
+     kernel keeps other mappings, in particular the stacks of other threads,
+     farther away from its top.  */
+  if (top != 0
+      && addr < top
+      && getrlimit (RLIMIT_STACK, &rl) >= 0
+      && rl.rlim_cur != RLIM_INFINITY
+      && top - addr < rl.rlim_cur)
+    {
+      *max_size = rl.rlim_cur;
+      return top;
+    }
+  return 0;
+}
+
+#endif
+
+/* Returns the address of the last byte belonging to the stack vma, or 0.
+   The cheap sources are tried first; reading the memory map is the last
+   resort.  The result may also be an address near the top of the stack
+   vma.  */
+static uintptr_t
+find_stack_top (void *some_variable_on_stack)
 {
   struct vma_struct vma;
 
+#if HAVE_MAIN_STACK_TOP
+  {
+    uintptr_t max_size;
+    uintptr_t top =
+      find_main_stack_top ((uintptr_t) some_variable_on_stack, &max_size);
+
+    if (top != 0)
+      return top;
+  }
+#endif
+#if HAVE_PTHREAD_GETATTR_NP && defined __linux__
+  /* For a thread other than the main thread, glibc and musl know the stack
+     without reading the memory map.  */
+  {
+    pthread_attr_t attr;
+    uintptr_t top = 0;
+
+    if (pthread_getattr_np (pthread_self (), &attr) == 0)
+      {
+        void *stack_addr;
+        size_t stack_size;
+
+        if (pthread_attr_getstack (&attr, &stack_addr, &stack_size) == 0
+            && (uintptr_t) some_variable_on_stack - (uintptr_t) stack_addr
+               < stack_size)
+          top = (uintptr_t) stack_addr + stack_size - 1;
+        pthread_attr_destroy (&attr);
+        if (top != 0)
+          return top;
+      }
+  }
+#endif
   if (sigsegv_get_vma ((uintptr_t) some_variable_on_stack, &vma) >= 0)
-    stack_top = vma.end - 1;
+    return vma.end - 1;
+  return 0;
+}
+
+/* The stacks of the threads, for sigsegv_thread_stack_ranges.  */
+#include "threadreg.h"
+
+/* What the current thread knows about its stack vma.  */
+struct stack_info
+{
+  /* The stack top for which it was determined, or 0.  */
+  uintptr_t top;
+  struct vma_struct vma;
+  /* The maximum stack size, or 0 if unknown.  */
+  uintptr_t max_size;
+  /* Nonzero if the stack vma cannot grow any more.  */
+  int final;
+};
+
+/* The part beyond the growing end of a stack that cannot grow any more, in
+   which a cached stack vma is used for classifying faults.  Linux keeps
+   this much room free of other mappings below the main stack.  */
+#define STACK_GAP_WINDOW 0x100000
+
+/* Returns the size of that part for the stack BOUNDS.  The stack of a thread
+   is a plain mapping, and another mapping may follow right after its guard
+   area; there, only the guard area is known.  */
+#define stack_gap_window(bounds) \
+  ((bounds)->fixed ? (bounds)->guard_end - (bounds)->guard_start \
+   : STACK_GAP_WINDOW)
+
+#if HAVE_THREAD_LOCAL
+/* Reading the memory map is expensive in processes with many mappings.
+   Therefore each thread caches the stack_info of its last stack overflow.
+   A stack vma only grows.  Once it has reached its maximal size, or if it
+   is the fixed-size stack of a thread, the cached info stays valid for
+   faults in the stack and in the gap or guard area next to it.  */
+static SV_THREAD_LOCAL struct stack_info stack_cache;
+#endif
+
+/* Returns the stack_info of the stack BOUNDS, for classifying a fault at
+   ADDR, or NULL if it cannot be determined.  BUF is used when there is no
+   cache.  */
+static const struct stack_info *
+get_stack_info (struct stack_bounds *bounds, uintptr_t addr,
+                struct stack_info *buf)
+{
+  struct stack_info *info;
+  int saved_errno;
+
+#if HAVE_THREAD_LOCAL
+  info = &stack_cache;
+  if (info->top == bounds->top
+# if STACK_DIRECTION < 0
+      && addr <= info->vma.end - 1
+      && (addr >= info->vma.start
+          || (info->final
+              && info->vma.start - addr <= stack_gap_window (bounds)))
+# else
+      && addr >= info->vma.start
+      && (addr <= info->vma.end - 1
+          || (info->final
+              && addr - info->vma.end < stack_gap_window (bounds)))
+# endif
+     )
+    return info;
+#else
+  info = buf;
+#endif
+
+  saved_errno = errno;
+  info->top = 0;
+  if (sigsegv_get_vma (bounds->top, &info->vma) < 0)
+    {
+      errno = saved_errno;
+      return NULL;
+    }
+  info->max_size = 0;
+#if HAVE_GETRLIMIT && defined RLIMIT_STACK
+  {
+    struct rlimit rl;
+
+    if (getrlimit (RLIMIT_STACK, &rl) >= 0)
+      info->max_size = rl.rlim_cur;
+  }
+#endif
+  errno = saved_errno;
+  info->final =
+    (bounds->fixed
+     || (info->max_size != 0
+         && info->vma.end - info->vma.start + 4096 >= info->max_size));
+  info->top = bounds->top;
+  /* The stack is mapped at least this far.  */
+#if STACK_DIRECTION < 0
+  sigsegv_thread_set_mapped (info->vma.start);
+#else
+  sigsegv_thread_set_mapped (info->vma.end);
+#endif
+  return info;
 }
 
 #endif /* HAVE_STACKVMA */
 
 static stackoverflow_handler_t stk_user_handler = (stackoverflow_handler_t)NULL;
-static uintptr_t stk_extra_stack;
-static size_t stk_extra_stack_size;
+
+/* Stacks registered with sigsegv_register_stack.  */
+#include "stackreg.h"
+
+/* The registered stack whose overflow is being handled by the current
+   thread, or NULL.  */
+static SV_THREAD_LOCAL struct registered_stack *overflowed_stack;
+
+/* The stack limit for sigsegv_stack_remaining.  */
+#include "stackuse.h"
+
+/* Returns the address up to which the stack of the calling thread, with
+   bounds BOUNDS, can grow, or 0 if it is not known.  */
+static uintptr_t
+find_stack_limit (struct stack_bounds *bounds, void *some_variable_on_stack)
+{
+  if (bounds->guard_end != 0)
+#if STACK_DIRECTION < 0
+    return bounds->guard_end;
+#else
+    return bounds->guard_start;
+#endif
+#if HAVE_STACKVMA && HAVE_MAIN_STACK_TOP
+  {
+    uintptr_t max_size;
+    uintptr_t top =
+      find_main_stack_top ((uintptr_t) some_variable_on_stack, &max_size);
+
+    if (top != 0)
+      {
+        /* The stack vma ends at the page boundary above TOP.  */
+        uintptr_t pagesize;
+        uintptr_t end;
+
+# if HAVE_GETPAGESIZE
+        pagesize = getpagesize ();
+# elif HAVE_SYSCONF_PAGESIZE
+        pagesize = sysconf (_SC_PAGESIZE);
+# else
+        pagesize = PAGESIZE;
+# endif
+        end = (top | (pagesize - 1)) + 1;
+        return (max_size < end ? end - max_size : 0);
+      }
+  }
+#endif
+#if HAVE_PTHREAD_GETATTR_NP
+  {
+    pthread_attr_t attr;
+    uintptr_t limit = 0;
+
+    if (pthread_getattr_np (pthread_self (), &attr) == 0)
+      {
+        void *stack_addr;
+        size_t stack_size;
+
+        if (pthread_attr_getstack (&attr, &stack_addr, &stack_size) == 0
+            && (uintptr_t) some_variable_on_stack - (uintptr_t) stack_addr
+               < stack_size)
+# if STACK_DIRECTION < 0
+          limit = (uintptr_t) stack_addr;
+# else
+          limit = (uintptr_t) stack_addr + stack_size;
+# endif
+        pthread_attr_destroy (&attr);
+        if (limit != 0)
+          return limit;
+      }
+  }
+#endif
+#if HAVE_STACKVMA && HAVE_GETRLIMIT && defined RLIMIT_STACK
+  {
+    struct vma_struct vma;
+    struct rlimit rl;
+
+    if (bounds->top
+        && sigsegv_get_vma (bounds->top, &vma) >= 0
+        && getrlimit (RLIMIT_STACK, &rl) >= 0
+        && rl.rlim_cur != RLIM_INFINITY)
+# if STACK_DIRECTION < 0
+      return (rl.rlim_cur < vma.end ? vma.end - rl.rlim_cur : 0);
+# else
+      return vma.start + rl.rlim_cur;
+# endif
+  }
+#endif
+  return 0;
+}
+
+/* Registers the calling thread, with stack bounds BOUNDS and stack limit
+   LIMIT, for sigsegv_thread_stack_ranges.  */
+static void
+add_thread (struct stack_bounds *bounds, uintptr_t limit,
+            void *some_variable_on_stack)
+{
+  uintptr_t base = 0;
+  uintptr_t mapped = limit;
+
+#if HAVE_STACKVMA
+  {
+    struct vma_struct vma;
+
+# if STACK_DIRECTION < 0
+    if (bounds->top)
+      {
+        base = bounds->top + 1;
+        /* The main thread's stack is mapped only as far as it has grown.  */
+        if (sigsegv_get_vma (bounds->top, &vma) >= 0 && vma.start > limit)
+          mapped = vma.start;
+      }
+# else
+    if (sigsegv_get_vma ((uintptr_t) some_variable_on_stack, &vma) >= 0)
+      {
+        base = vma.start;
+        if (vma.end < limit)
+          mapped = vma.end;
+      }
+# endif
+  }
+#endif
+  if (base != 0 && limit != 0)
+    sigsegv_thread_add (base, limit, mapped,
+                        bounds->extra_stack, bounds->extra_stack_size);
+}
 
 #endif /* HAVE_STACK_OVERFLOW_RECOVERY */
 
@@ -123,8 +487,176 @@ static size_t stk_extra_stack_size;
 /* User's SIGSEGV handler.  */
 static sigsegv_handler_t user_handler = (sigsegv_handler_t)NULL;
 
+/* Safepoint polling page.  */
+#include "safepoint.h"
+
+/* Data watchpoints.  */
+#include "watch.h"
+
 #endif /* HAVE_SIGSEGV_RECOVERY */
 
+/* Handling of SIGILL, SIGFPE, SIGTRAP needs the siginfo_t, for si_code.  */
+#if HAVE_SIGSEGV_RECOVERY && defined SIGSEGV_FAULT_ADDRESS_FROM_SIGINFO
+# define HAVE_TRAP_RECOVERY 1
+#endif
+
+#include "dispatcher.h"
+
+#if HAVE_TRAP_RECOVERY
+
+/* A registered trap handler.  The ticket of sigsegv_register_trap.  */
+struct trap_registration
+{
+  sigsegv_trap_handler_t handler;
+  void *handler_arg;
+  /* The ticket in trap_dispatcher.  */
+  void *ticket;
+};
+
+/* Table of code ranges with a trap handler.  The handler argument of each
+   range is its struct trap_registration.  */
+static sigsegv_dispatcher trap_dispatcher;
+
+/* Whether the signal handlers for the trap signals are installed.  */
+static int trap_handlers_installed = 0;
+
+#endif /* HAVE_TRAP_RECOVERY */
+
+/* Decoding of faulting instructions.  */
+#if HAVE_SIGSEGV_RECOVERY && defined SIGSEGV_FAULT_CONTEXT \
+    && defined __linux__ && defined __x86_64__
+# define HAVE_ACCESS_EMULATION 1
+# include "emulate-x86_64.c"
+#endif
+
+#if HAVE_ACCESS_EMULATION
+/* The context of the fault that the current thread is handling.  */
+static SV_THREAD_LOCAL stackoverflow_context_t current_context;
+#endif
+
+/* Single-stepping of faulting instructions, for SIGSEGV_AREA_SINGLESTEP.  */
+#if HAVE_TRAP_RECOVERY && defined SIGSEGV_FAULT_TRACE_FLAGS
+# define HAVE_SINGLESTEP 1
+#endif
+
+#if HAVE_SINGLESTEP
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "atomic.h"
+
+/* The maximum number of pages that one instruction can access.  */
+#define SINGLESTEP_MAX_PAGES 4
+
+/* The pages that the current thread has made accessible for the
+   instruction that it is stepping, and their protection afterwards.  */
+static SV_THREAD_LOCAL struct
+{
+  unsigned int count;
+  uintptr_t pages[SINGLESTEP_MAX_PAGES];
+  int prots[SINGLESTEP_MAX_PAGES];
+}
+singlestep_batch;
+
+/* The pages that are accessible because some threads are stepping an
+   instruction that accesses them, with the number of such threads.
+   A page is protected again only when the last of these threads is done,
+   so that no thread faults twice on the same access.  */
+#define SINGLESTEP_MAX_OPEN_PAGES 64
+static struct
+{
+  uintptr_t page;
+  unsigned int users;
+}
+open_pages[SINGLESTEP_MAX_OPEN_PAGES];
+
+/* A spin lock protecting open_pages.  It is only taken in SIGSEGV and
+   SIGTRAP handlers, which cannot interrupt each other in the same thread
+   while it is held.  */
+static volatile unsigned int open_pages_lock;
+
+static uintptr_t singlestep_pagesize;
+
+static void
+lock_open_pages (void)
+{
+  while (!sv_atomic_compare_and_swap (&open_pages_lock, 0, 1))
+    ;
+}
+
+static void
+unlock_open_pages (void)
+{
+  sv_atomic_store (&open_pages_lock, 0);
+}
+
+/* Makes PAGE accessible, for one more thread.  Returns 0 or -1.  */
+static int
+open_page (uintptr_t page)
+{
+  int free_slot = -1;
+  int ret = 0;
+  int i;
+
+  lock_open_pages ();
+  for (i = 0; i < SINGLESTEP_MAX_OPEN_PAGES; i++)
+    if (open_pages[i].users > 0)
+      {
+        if (open_pages[i].page == page)
+          {
+            open_pages[i].users++;
+            goto done;
+          }
+      }
+    else if (free_slot < 0)
+      free_slot = i;
+  if (free_slot < 0
+      || mprotect ((void *) page, singlestep_pagesize,
+                   PROT_READ | PROT_WRITE) < 0)
+    ret = -1;
+  else
+    {
+      open_pages[free_slot].page = page;
+      open_pages[free_slot].users = 1;
+    }
+ done:
+  unlock_open_pages ();
+  return ret;
+}
+
+/* Protects PAGE with PROT again, unless other threads still need it.  */
+static void
+close_page (uintptr_t page, int prot)
+{
+  int i;
+
+  lock_open_pages ();
+  for (i = 0; i < SINGLESTEP_MAX_OPEN_PAGES; i++)
+    if (open_pages[i].users > 0 && open_pages[i].page == page)
+      {
+        if (--open_pages[i].users == 0)
+          mprotect ((void *) page, singlestep_pagesize, prot);
+        break;
+      }
+  unlock_open_pages ();
+}
+
+/* Called in the SIGTRAP handler after the instruction has been stepped.  */
+static void
+singlestep_done (void)
+{
+  int saved_errno = errno;
+  unsigned int i;
+
+  for (i = 0; i < singlestep_batch.count; i++)
+    close_page (singlestep_batch.pages[i], singlestep_batch.prots[i]);
+  singlestep_batch.count = 0;
+  errno = saved_errno;
+}
+
+#endif /* HAVE_SINGLESTEP */
+
 
 /* Our SIGSEGV handler, with OS dependent argument list.  */
 
@@ -134,12 +666,71 @@ static void
 sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
 {
   void *address = (void *) (SIGSEGV_FAULT_ADDRESS);
+#if HAVE_ACCESS_EMULATION
+  stackoverflow_context_t saved_context;
+#endif
+
+  /* A poll of the armed safepoint page is not a fault.  The thread gets
+     parked here and, once released, retries the poll.  */
+#if defined SIGSEGV_FAULT_CONTEXT && defined SIGSEGV_FAULT_STACKPOINTER
+  if (sigsegv_safepoint_fault (address, (SIGSEGV_FAULT_CONTEXT),
+                               (uintptr_t) (SIGSEGV_FAULT_STACKPOINTER)))
+#elif defined SIGSEGV_FAULT_CONTEXT
+  if (sigsegv_safepoint_fault (address, (SIGSEGV_FAULT_CONTEXT), 0))
+#else
+  if (sigsegv_safepoint_fault (address, (void *) 0, 0))
+#endif
+    return;
+
+#if HAVE_ACCESS_EMULATION
+  /* Let the user's handlers decode the faulting instruction.  */
+  saved_context = current_context;
+  current_context = (SIGSEGV_FAULT_CONTEXT);
+#endif
+
+#if HAVE_SINGLESTEP
+  /* An access to a watched page.  */
+  if (sigsegv_watch_fault (address))
+    goto done;
+#endif
 
 #if HAVE_STACK_OVERFLOW_RECOVERY
 #if !(HAVE_STACKVMA || defined SIGSEGV_FAULT_STACKPOINTER)
 #error "Insufficient heuristics for detecting a stack overflow.  Either define CFG_STACKVMA and HAVE_STACKVMA correctly, or define SIGSEGV_FAULT_STACKPOINTER correctly, or undefine HAVE_STACK_OVERFLOW_RECOVERY!"
 #endif
 
+  /* A fault in the guard area of a growable stack: grow the stack, unless
+     it has reached its limit.  A fault in the yellow zone of a stack:
+     unprotect the zone and let the thread continue on its own stack.  */
+  {
+    struct registered_stack *stack =
+      sigsegv_stack_find_guard ((uintptr_t) address);
+
+    if (stack != NULL)
+      {
+        if (stack->chunk != 0 && sigsegv_stack_grow (stack) == 0)
+          {
+#if STACK_DIRECTION < 0
+            sigsegv_thread_set_mapped (stack->lo);
+#else
+            sigsegv_thread_set_mapped (stack->hi);
+#endif
+            goto done;
+          }
+        if (stack->yellow_end != 0
+            && sigsegv_stack_disarm_yellow (stack, (uintptr_t) address) == 0)
+          {
+            if (stack->yellow_handler != NULL)
+#ifdef SIGSEGV_FAULT_CONTEXT
+              (*stack->yellow_handler) (stack, (SIGSEGV_FAULT_CONTEXT));
+#else
+              (*stack->yellow_handler) (stack, (void *) 0);
+#endif
+            goto done;
+          }
+      }
+  }
+
   /* Call user's handler.  */
   if (user_handler && (*user_handler) (address, 0))
     {
@@ -149,10 +740,31 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
     {
       /* Handler declined responsibility.  */
 
+      /* Heuristic R: A fault in the guard area of a registered stack is an
+         overflow of that stack.  */
+      if (stk_user_handler
+          && (overflowed_stack =
+                sigsegv_stack_find_guard ((uintptr_t) address)) != NULL)
+        {
+#ifdef SIGSEGV_FAULT_STACKPOINTER
+          struct stack_bounds *bounds = current_stack_bounds ();
+          uintptr_t old_sp = (uintptr_t) (SIGSEGV_FAULT_STACKPOINTER);
+          int emergency =
+            (old_sp >= bounds->extra_stack
+             && old_sp <= bounds->extra_stack + bounds->extra_stack_size);
+          stackoverflow_context_t context = (SIGSEGV_FAULT_CONTEXT);
+#else
+          int emergency = 0;
+          stackoverflow_context_t context = (void *) 0;
+#endif
+          /* Call user's handler.  */
+          (*stk_user_handler) (emergency, context);
+        }
       /* Did the user install a stack overflow handler?  */
-      if (stk_user_handler)
+      else if (stk_user_handler)
         {
           /* See whether it was a stack overflow. If so, longjump away.  */
+          struct stack_bounds *bounds = current_stack_bounds ();
 #ifdef SIGSEGV_FAULT_STACKPOINTER
           uintptr_t old_sp = (uintptr_t) (SIGSEGV_FAULT_STACKPOINTER);
 #ifdef __ia64
@@ -162,25 +774,31 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
 
 #if HAVE_STACKVMA
           /* Were we able to determine the stack top?  */
-          if (stack_top)
+          if (bounds->top)
             {
               /* Determine stack bounds.  */
-              int saved_errno;
-              struct vma_struct vma;
-              int ret;
+              struct stack_info buf;
+              const struct stack_info *info;
 
-              saved_errno = errno;
-              ret = sigsegv_get_vma (stack_top, &vma);
-              errno = saved_errno;
-              if (ret >= 0)
+#if !defined BOGUS_FAULT_ADDRESS_UPON_STACK_OVERFLOW
+              info = get_stack_info (bounds, (uintptr_t) address, &buf);
+#elif defined SIGSEGV_FAULT_STACKPOINTER
+              info = get_stack_info (bounds, old_sp, &buf);
+#else
+              info = get_stack_info (bounds, 0, &buf);
+#endif
+              if (info != NULL)
                 {
+                  struct vma_struct vma = info->vma;
 #ifndef BOGUS_FAULT_ADDRESS_UPON_STACK_OVERFLOW
                   /* Heuristic AC: If the fault_address is nearer to the stack
                      segment's [start,end] than to the previous segment, we
                      consider it a stack overflow.
                      In the case of IA-64, we know that the previous segment
                      is the up-growing bsp segment, and either of the two
-                     stacks can overflow.  */
+                     stacks can overflow.
+                     The previous segment may also be the guard area of a
+                     thread's stack; then the fault address is in it.  */
                   uintptr_t addr = (uintptr_t) address;
 
 #ifdef __ia64
@@ -189,11 +807,13 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
 #if STACK_DIRECTION < 0
                   if (addr >= vma.start
                       ? (addr <= vma.end - 1)
-                      : vma.is_near_this (addr, &vma))
+                      : (vma.is_near_this (addr, &vma)
+                         || is_in_guard (addr, bounds)))
 #else
                   if (addr <= vma.end - 1
                       ? (addr >= vma.start)
-                      : vma.is_near_this (addr, &vma))
+                      : (vma.is_near_this (addr, &vma)
+                         || is_in_guard (addr, bounds)))
 #endif
 #endif
                     {
@@ -202,15 +822,10 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
                   /* Heuristic BC: If the stack size has reached its maximal size,
                      and old_sp is near the low end, we consider it a stack
                      overflow.  */
-                  struct rlimit rl;
-
-                  saved_errno = errno;
-                  ret = getrlimit (RLIMIT_STACK, &rl);
-                  errno = saved_errno;
-                  if (ret >= 0)
+                  if (info->max_size != 0)
                     {
                       uintptr_t current_stack_size = vma.end - vma.start;
-                      uintptr_t max_stack_size = rl.rlim_cur;
+                      uintptr_t max_stack_size = info->max_size;
                       if (current_stack_size <= max_stack_size + 4096
                           && max_stack_size <= current_stack_size + 4096
 #else
@@ -221,8 +836,8 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
                           /* Heuristic BC: If we know old_sp, and it is neither
                              near the low end, nor in the alternate stack, then
                              it's probably not a stack overflow.  */
-                          && ((old_sp >= stk_extra_stack
-                               && old_sp <= stk_extra_stack + stk_extra_stack_size)
+                          && ((old_sp >= bounds->extra_stack
+                               && old_sp <= bounds->extra_stack + bounds->extra_stack_size)
 #if STACK_DIRECTION < 0
                               || (old_sp <= vma.start + 4096
                                   && vma.start <= old_sp + 4096))
@@ -250,8 +865,8 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
                         {
 #ifdef SIGSEGV_FAULT_STACKPOINTER
                           int emergency =
-                            (old_sp >= stk_extra_stack
-                             && old_sp <= stk_extra_stack + stk_extra_stack_size);
+                            (old_sp >= bounds->extra_stack
+                             && old_sp <= bounds->extra_stack + bounds->extra_stack_size);
                           stackoverflow_context_t context = (SIGSEGV_FAULT_CONTEXT);
 #else
                           int emergency = 0;
@@ -281,6 +896,19 @@ sigsegv_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
 #if HAVE_STACK_OVERFLOW_RECOVERY
     }
 #endif /* HAVE_STACK_OVERFLOW_RECOVERY */
+
+#if HAVE_SINGLESTEP || HAVE_STACK_OVERFLOW_RECOVERY
+ done:
+#endif
+#if HAVE_ACCESS_EMULATION
+  current_context = saved_context;
+#endif
+
+#if HAVE_SINGLESTEP
+  /* Execute the faulting instruction in single-step mode.  */
+  if (singlestep_batch.count > 0)
+    SIGSEGV_FAULT_TRACE_FLAGS |= SIGSEGV_FAULT_TRACE_BIT;
+#endif
 }
 
 #elif HAVE_STACK_OVERFLOW_RECOVERY
@@ -300,36 +928,34 @@ sigsegv_handler (int sig)
   if (stk_user_handler)
     {
       /* See whether it was a stack overflow.  If so, longjump away.  */
+      struct stack_bounds *bounds = current_stack_bounds ();
 #ifdef SIGSEGV_FAULT_STACKPOINTER
       uintptr_t old_sp = (uintptr_t) (SIGSEGV_FAULT_STACKPOINTER);
 #endif
 
       /* Were we able to determine the stack top?  */
-      if (stack_top)
+      if (bounds->top)
         {
           /* Determine stack bounds.  */
-          int saved_errno;
-          struct vma_struct vma;
-          int ret;
-
-          saved_errno = errno;
-          ret = sigsegv_get_vma (stack_top, &vma);
-          errno = saved_errno;
-          if (ret >= 0)
+          struct stack_info buf;
+          const struct stack_info *info;
+
+#ifdef SIGSEGV_FAULT_STACKPOINTER
+          info = get_stack_info (bounds, old_sp, &buf);
+#else
+          info = get_stack_info (bounds, 0, &buf);
+#endif
+          if (info != NULL)
             {
+              struct vma_struct vma = info->vma;
 #if HAVE_GETRLIMIT && defined RLIMIT_STACK
               /* Heuristic BC: If the stack size has reached its maximal size,
                  and old_sp is near the low end, we consider it a stack
                  overflow.  */
-              struct rlimit rl;
-
-              saved_errno = errno;
-              ret = getrlimit (RLIMIT_STACK, &rl);
-              errno = saved_errno;
-              if (ret >= 0)
+              if (info->max_size != 0)
                 {
                   uintptr_t current_stack_size = vma.end - vma.start;
-                  uintptr_t max_stack_size = rl.rlim_cur;
+                  uintptr_t max_stack_size = info->max_size;
                   if (current_stack_size <= max_stack_size + 4096
                       && max_stack_size <= current_stack_size + 4096
 #else
@@ -340,8 +966,8 @@ sigsegv_handler (int sig)
                       /* Heuristic BC: If we know old_sp, and it is neither
                          near the low end, nor in the alternate stack, then
                          it's probably not a stack overflow.  */
-                      && ((old_sp >= stk_extra_stack
-                           && old_sp <= stk_extra_stack + stk_extra_stack_size)
+                      && ((old_sp >= bounds->extra_stack
+                           && old_sp <= bounds->extra_stack + bounds->extra_stack_size)
 #if STACK_DIRECTION < 0
                           || (old_sp <= vma.start + 4096
                               && vma.start <= old_sp + 4096))
@@ -354,8 +980,8 @@ sigsegv_handler (int sig)
                     {
 #ifdef SIGSEGV_FAULT_STACKPOINTER
                       int emergency =
-                        (old_sp >= stk_extra_stack
-                         && old_sp <= stk_extra_stack + stk_extra_stack_size);
+                        (old_sp >= bounds->extra_stack
+                         && old_sp <= bounds->extra_stack + bounds->extra_stack_size);
                       stackoverflow_context_t context = (SIGSEGV_FAULT_CONTEXT);
 #else
                       int emergency = 0;
@@ -376,6 +1002,67 @@ sigsegv_handler (int sig)
 #endif
 
 
+#if HAVE_TRAP_RECOVERY
+
+/* Our SIGILL, SIGFPE, SIGTRAP handler.  */
+static void
+trap_handler (SIGSEGV_FAULT_HANDLER_ARGLIST)
+{
+#ifdef SIGSEGV_FAULT_PROGRAM_COUNTER
+  void *pc = (void *) (SIGSEGV_FAULT_PROGRAM_COUNTER);
+#else
+  /* POSIX specifies that for these signals, si_addr is the address of the
+     faulting instruction.  */
+  void *pc = (void *) (SIGSEGV_FAULT_ADDRESS);
+#endif
+#ifdef SIGSEGV_FAULT_CONTEXT
+  stackoverflow_context_t context = (SIGSEGV_FAULT_CONTEXT);
+#else
+  stackoverflow_context_t context = (void *) 0;
+#endif
+  sigsegv_area_handler_t handler;
+  void *handler_arg;
+  struct trap_registration *reg;
+
+#if HAVE_SINGLESTEP
+  if (sig == SIGTRAP && singlestep_batch.count > 0)
+    {
+      /* An instruction that accessed a SIGSEGV_AREA_SINGLESTEP area has been
+         executed.  */
+      singlestep_done ();
+      SIGSEGV_FAULT_TRACE_FLAGS &= ~SIGSEGV_FAULT_TRACE_BIT;
+      return;
+    }
+#endif
+
+  if (sigsegv_dispatcher_lookup (&trap_dispatcher, pc, &handler, &handler_arg)
+      && (reg = (struct trap_registration *) handler_arg,
+          (*reg->handler) (sig, sip->si_code, pc, reg->handler_arg, context)))
+    {
+      /* Handler successful.  */
+    }
+  else
+    {
+      /* Handler declined responsibility.  Remove ourselves and raise the
+         signal again.  It is blocked until we return; then it terminates
+         the process.  This works also for traps after which the program
+         counter does not point to the trapping instruction any more.  */
+      signal (sig, SIG_DFL);
+      raise (sig);
+    }
+}
+
+/* Returns nonzero if SIG is one of SIGSEGV_FOR_ALL_TRAP_SIGNALS.  */
+static int
+is_trap_signal (int sig)
+{
+  SIGSEGV_FOR_ALL_TRAP_SIGNALS (trap_sig, if (sig == trap_sig) return 1;)
+  return 0;
+}
+
+#endif /* HAVE_TRAP_RECOVERY */
+
+
 static void
 install_for (int sig)
 {
@@ -385,6 +1072,10 @@ install_for (int sig)
   action.sa_sigaction = (void (*) (int, siginfo_t *, void *)) &sigsegv_handler;
 #else
   action.sa_handler = (void (*) (int)) &sigsegv_handler;
+#endif
+#if HAVE_TRAP_RECOVERY
+  if (is_trap_signal (sig))
+    action.sa_sigaction = (void (*) (int, siginfo_t *, void *)) &trap_handler;
 #endif
   /* Block most signals while SIGSEGV is being handled.  */
   /* Signals SIGKILL, SIGSTOP cannot be blocked.  */
@@ -487,15 +1178,211 @@ sigsegv_install_handler (sigsegv_handler_t handler)
 #endif
 }
 
+#if HAVE_SIGSEGV_RECOVERY
+
+/* Returns nonzero if the global SIGSEGV handler, the stack overflow handler,
+   the safepoint or a watchpoint still needs the signal handlers.  */
+static int
+sigsegv_handlers_needed (void)
+{
+  return (user_handler != (sigsegv_handler_t) NULL
+#if HAVE_STACK_OVERFLOW_RECOVERY
+          || stk_user_handler != (stackoverflow_handler_t) NULL
+#endif
+          || sigsegv_safepoint_exists ()
+          || sigsegv_watch_exists ());
+}
+
+#endif
+
 void
 sigsegv_deinstall_handler (void)
 {
 #if HAVE_SIGSEGV_RECOVERY
   user_handler = (sigsegv_handler_t)NULL;
 
-#if HAVE_STACK_OVERFLOW_RECOVERY
-  if (!stk_user_handler)
+  if (!sigsegv_handlers_needed ())
+    {
+      SIGSEGV_FOR_ALL_SIGNALS (sig, signal (sig, SIG_DFL);)
+    }
 #endif
+}
+
+#if HAVE_TRAP_RECOVERY
+
+/* The area handler of the ranges in trap_dispatcher.  trap_dispatcher is only
+   used through sigsegv_dispatcher_lookup, therefore it is never called.  */
+static int
+trap_area_handler (void *fault_address, void *user_arg)
+{
+  return 0;
+}
+
+static void
+install_trap_handlers (void)
+{
+  if (!trap_handlers_installed)
+    {
+      SIGSEGV_FOR_ALL_TRAP_SIGNALS (sig, install_for (sig);)
+      trap_handlers_installed = 1;
+    }
+}
+
+#endif
+
+void *
+sigsegv_register_trap (void *pc, size_t len,
+                       sigsegv_trap_handler_t handler, void *handler_arg)
+{
+#if HAVE_TRAP_RECOVERY
+  struct trap_registration *reg;
+
+  if (len == 0)
+    return (void *) 0;
+  reg = (struct trap_registration *) malloc (sizeof (struct trap_registration));
+  if (reg == NULL)
+    return (void *) 0;
+  reg->handler = handler;
+  reg->handler_arg = handler_arg;
+  reg->ticket =
+    sigsegv_register (&trap_dispatcher, pc, len, trap_area_handler, reg);
+  install_trap_handlers ();
+  return reg;
+#else
+  return (void *) 0;
+#endif
+}
+
+void
+sigsegv_unregister_trap (void *ticket)
+{
+#if HAVE_TRAP_RECOVERY
+  if (ticket != NULL)
+    {
+      struct trap_registration *reg = (struct trap_registration *) ticket;
+
+      sigsegv_unregister (&trap_dispatcher, reg->ticket);
+      free (reg);
+    }
+#endif
+}
+
+int
+sigsegv_singlestep_init (void)
+{
+#if HAVE_SINGLESTEP
+  if (singlestep_pagesize == 0)
+    {
+# if HAVE_GETPAGESIZE
+      singlestep_pagesize = getpagesize ();
+# elif HAVE_SYSCONF_PAGESIZE
+      singlestep_pagesize = sysconf (_SC_PAGESIZE);
+# else
+      singlestep_pagesize = PAGESIZE;
+# endif
+    }
+  install_trap_handlers ();
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+int
+sigsegv_singlestep (void *fault_address, int readonly)
+{
+#if HAVE_SINGLESTEP
+  uintptr_t page = (uintptr_t) fault_address & -singlestep_pagesize;
+  unsigned int n = singlestep_batch.count;
+
+  if (n == SINGLESTEP_MAX_PAGES || open_page (page) < 0)
+    return -1;
+  singlestep_batch.pages[n] = page;
+  singlestep_batch.prots[n] = (readonly ? PROT_READ : PROT_NONE);
+  singlestep_batch.count = n + 1;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+void *
+sigsegv_watch (void *address, size_t len, int flags,
+               sigsegv_watch_handler_t handler, void *handler_arg)
+{
+#if HAVE_SINGLESTEP
+  void *ticket;
+
+  if (sigsegv_singlestep_init () < 0)
+    return (void *) 0;
+  ticket = sigsegv_watch_add (address, len, flags, handler, handler_arg);
+  if (ticket != NULL)
+    SIGSEGV_FOR_ALL_SIGNALS (sig, install_for (sig);)
+  return ticket;
+#else
+  return (void *) 0;
+#endif
+}
+
+void
+sigsegv_unwatch (void *ticket)
+{
+#if HAVE_SINGLESTEP
+  sigsegv_watch_remove (ticket);
+#endif
+}
+
+int
+sigsegv_decode_access (sigsegv_access *access)
+{
+#if HAVE_ACCESS_EMULATION
+  if (current_context == NULL)
+    return -1;
+  return decode_access (current_context, access);
+#else
+  return -1;
+#endif
+}
+
+void
+sigsegv_complete_access (const sigsegv_access *access,
+                         unsigned long long value)
+{
+#if HAVE_ACCESS_EMULATION
+  complete_access (access, value);
+#endif
+}
+
+void
+sigsegv_emulate_access (const sigsegv_access *access, void *shadow)
+{
+#if HAVE_ACCESS_EMULATION
+  emulate_access (access, shadow);
+#endif
+}
+
+void *
+sigsegv_safepoint_install (sigsegv_safepoint_handler_t handler)
+{
+#if HAVE_SIGSEGV_RECOVERY
+  void *page = sigsegv_safepoint_create (handler);
+
+  if (page != NULL)
+    SIGSEGV_FOR_ALL_SIGNALS (sig, install_for (sig);)
+
+  return page;
+#else
+  return (void *) 0;
+#endif
+}
+
+void
+sigsegv_safepoint_deinstall (void)
+{
+#if HAVE_SIGSEGV_RECOVERY
+  sigsegv_safepoint_destroy ();
+
+  if (!sigsegv_handlers_needed ())
     {
       SIGSEGV_FOR_ALL_SIGNALS (sig, signal (sig, SIG_DFL);)
     }
@@ -520,50 +1407,335 @@ sigsegv_leave_handler (void (*continuation) (void*, void*, void*),
 
 #if !MIXING_UNIX_SIGSEGV_AND_WIN32_STACKOVERFLOW_HANDLING
 
+#if HAVE_STACK_OVERFLOW_RECOVERY && !defined __BEOS__
+
+/* Makes EXTRA_STACK the alternate signal stack of the current thread.
+   Returns 0 or -1.  */
+static int
+set_alternate_stack (void *extra_stack, size_t extra_stack_size)
+{
+  stack_t ss;
+#if SIGALTSTACK_SS_REVERSED
+  ss.ss_sp = (char *) extra_stack + extra_stack_size - sizeof (void *);
+  ss.ss_size = extra_stack_size - sizeof (void *);
+#else
+  ss.ss_sp = extra_stack;
+  ss.ss_size = extra_stack_size;
+#endif
+  ss.ss_flags = 0; /* no SS_DISABLE */
+  return sigaltstack (&ss, (stack_t*)0);
+}
+
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY
+
+/* Makes EXTRA_STACK the alternate signal stack of the current thread, and
+   records it in BOUNDS.  If EXTRA_STACK is NULL, uses a stack from the pool
+   instead, or the one that BOUNDS already has from the pool.
+   Returns 0 or -1.  */
+static int
+use_alternate_stack (struct stack_bounds *bounds,
+                     void *extra_stack, size_t extra_stack_size)
+{
+  void *old_pooled = (bounds->pooled ? (void *) bounds->extra_stack : NULL);
+  int pooled = 0;
+
+  if (extra_stack == NULL)
+    {
+      if (old_pooled != NULL)
+        {
+          extra_stack = old_pooled;
+          extra_stack_size = bounds->extra_stack_size;
+          old_pooled = NULL;
+        }
+      else
+        {
+          extra_stack = sigsegv_altstack_allocate (&extra_stack_size);
+          if (extra_stack == NULL)
+            return -1;
+        }
+      pooled = 1;
+    }
+#ifdef __BEOS__
+  set_signal_stack (extra_stack, extra_stack_size);
+#else /* HAVE_SIGALTSTACK */
+  if (set_alternate_stack (extra_stack, extra_stack_size) < 0)
+    {
+      if (pooled && extra_stack != (void *) bounds->extra_stack)
+        sigsegv_altstack_release (extra_stack);
+      return -1;
+    }
+#endif
+  if (old_pooled != NULL)
+    sigsegv_altstack_release (old_pooled);
+  bounds->extra_stack = (uintptr_t) extra_stack;
+  bounds->extra_stack_size = extra_stack_size;
+  bounds->pooled = pooled;
+  return 0;
+}
+
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_THREAD_LOCAL && HAVE_PTHREAD_KEY_CREATE && !defined __BEOS__
+
+/* A thread that got its alternate stack from the pool gives it back when it
+   exits, through the destructor of this key.  */
+static pthread_key_t exit_key;
+/* 0 = not yet created, 1 = being created, 2 = created, 3 = failed.  */
+static volatile unsigned int exit_key_state;
+
+static void
+thread_exit (void *arg)
+{
+  stackoverflow_unregister_thread ();
+}
+
+/* Creates exit_key, if not yet done.  Returns 0 or -1.  */
+static int
+init_exit_key (void)
+{
+  for (;;)
+    {
+      unsigned int state = sv_atomic_load (&exit_key_state);
+
+      if (state == 2)
+        return 0;
+      if (state == 3)
+        return -1;
+      if (state == 0 && sv_atomic_compare_and_swap (&exit_key_state, 0, 1))
+        {
+          state = (pthread_key_create (&exit_key, thread_exit) == 0 ? 2 : 3);
+          sv_atomic_store (&exit_key_state, state);
+          return (state == 2 ? 0 : -1);
+        }
+    }
+}
+
+# define RECYCLE_AT_THREAD_EXIT 1
+
+#endif
+
 int
 stackoverflow_install_handler (stackoverflow_handler_t handler,
                                void *extra_stack, size_t extra_stack_size)
 {
 #if HAVE_STACK_OVERFLOW_RECOVERY
 #if HAVE_STACKVMA
-  if (!stack_top)
+  if (!process_stack.top)
     {
       int dummy;
-      remember_stack_top (&dummy);
-      if (!stack_top)
+      process_stack.top = find_stack_top (&dummy);
+      if (!process_stack.top)
         return -1;
     }
 #endif
 
-  stk_user_handler = handler;
-  stk_extra_stack = (uintptr_t) extra_stack;
-  stk_extra_stack_size = extra_stack_size;
-#ifdef __BEOS__
-  set_signal_stack (extra_stack, extra_stack_size);
-#else /* HAVE_SIGALTSTACK */
+  if (use_alternate_stack (&process_stack, extra_stack, extra_stack_size) < 0)
+    return -1;
   {
-    stack_t ss;
-#if SIGALTSTACK_SS_REVERSED
-    ss.ss_sp = (char *) extra_stack + extra_stack_size - sizeof (void *);
-    ss.ss_size = extra_stack_size - sizeof (void *);
+    int dummy;
+    uintptr_t limit = find_stack_limit (&process_stack, &dummy);
+
+    sigsegv_set_thread_stack_limit (limit);
+    add_thread (&process_stack, limit, &dummy);
+  }
+  stk_user_handler = handler;
+
+  /* Install the signal handlers with SA_ONSTACK.  */
+  SIGSEGV_FOR_ALL_SIGNALS (sig, install_for (sig);)
+  return 0;
 #else
-    ss.ss_sp = extra_stack;
-    ss.ss_size = extra_stack_size;
+  return -1;
 #endif
-    ss.ss_flags = 0; /* no SS_DISABLE */
-    if (sigaltstack (&ss, (stack_t*)0) < 0)
-      return -1;
+}
+
+int
+stackoverflow_register_thread (void *extra_stack, size_t extra_stack_size)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_THREAD_LOCAL && !defined __BEOS__
+  struct stack_bounds bounds;
+  int dummy;
+
+  bounds.guard_start = 0;
+  bounds.guard_end = 0;
+  bounds.fixed = 0;
+#if HAVE_STACKVMA
+  bounds.top = find_stack_top (&dummy);
+  if (!bounds.top)
+    return -1;
+#endif
+#if HAVE_PTHREAD_GETATTR_NP
+  /* Determine the guard area.  The kernel does not report it as part of
+     the stack, since it is a separate mapping.  */
+  {
+    pthread_attr_t attr;
+
+    if (pthread_getattr_np (pthread_self (), &attr) == 0)
+      {
+        void *stack_addr;
+        size_t stack_size;
+        size_t guard_size;
+
+        if (pthread_attr_getstack (&attr, &stack_addr, &stack_size) == 0
+            && pthread_attr_getguardsize (&attr, &guard_size) == 0
+            && (uintptr_t) &dummy - (uintptr_t) stack_addr < stack_size)
+          {
+# if STACK_DIRECTION < 0
+            bounds.guard_start = (uintptr_t) stack_addr - guard_size;
+            bounds.guard_end = (uintptr_t) stack_addr;
+# else
+            bounds.guard_start = (uintptr_t) stack_addr + stack_size;
+            bounds.guard_end = bounds.guard_start + guard_size;
+# endif
+# if HAVE_STACKVMA
+            /* A thread's stack is usually mapped in its full size.  */
+            {
+              struct vma_struct vma;
+
+              if (sigsegv_get_vma (bounds.top, &vma) >= 0
+                  && vma.start <= (uintptr_t) stack_addr
+                  && vma.end >= (uintptr_t) stack_addr + stack_size)
+                bounds.fixed = 1;
+            }
+# endif
+          }
+        pthread_attr_destroy (&attr);
+      }
   }
 #endif
+  bounds.extra_stack = thread_stack.extra_stack;
+  bounds.extra_stack_size = thread_stack.extra_stack_size;
+  bounds.pooled = thread_stack.pooled;
 
-  /* Install the signal handlers with SA_ONSTACK.  */
-  SIGSEGV_FOR_ALL_SIGNALS (sig, install_for (sig);)
+  if (use_alternate_stack (&bounds, extra_stack, extra_stack_size) < 0)
+    return -1;
+  thread_stack = bounds;
+#if HAVE_STACKVMA
+  stack_cache.top = 0;
+#endif
+  {
+    uintptr_t limit = find_stack_limit (&bounds, &dummy);
+
+    sigsegv_set_thread_stack_limit (limit);
+    add_thread (&bounds, limit, &dummy);
+  }
+#if RECYCLE_AT_THREAD_EXIT
+  /* Also a thread with an alternate stack of its own is unregistered when it
+     exits, so that it no longer appears in sigsegv_thread_stack_ranges.  */
+  if (init_exit_key () == 0)
+    pthread_setspecific (exit_key, &thread_stack);
+#endif
   return 0;
 #else
   return -1;
 #endif
 }
 
+void
+stackoverflow_unregister_thread (void)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_THREAD_LOCAL && !defined __BEOS__
+  if (thread_stack.extra_stack != 0)
+    {
+      uintptr_t extra_stack = thread_stack.extra_stack;
+      stack_t ss;
+
+      thread_stack.extra_stack = 0;
+      ss.ss_flags = SS_DISABLE;
+      if (sigaltstack (&ss, (stack_t *) 0) < 0)
+        perror ("libsigsegv (stackoverflow_unregister_thread)");
+      else if (thread_stack.pooled)
+        sigsegv_altstack_release ((void *) extra_stack);
+      thread_stack.pooled = 0;
+#if RECYCLE_AT_THREAD_EXIT
+      if (sv_atomic_load (&exit_key_state) == 2)
+        pthread_setspecific (exit_key, NULL);
+#endif
+    }
+  sigsegv_set_thread_stack_limit (0);
+  sigsegv_thread_remove ();
+#endif
+}
+
+void *
+sigsegv_register_stack (void *lo, void *hi, size_t guard)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY
+  return sigsegv_stack_add ((uintptr_t) lo, (uintptr_t) hi, guard);
+#else
+  return (void *) 0;
+#endif
+}
+
+void *
+sigsegv_register_growable_stack (void *start, size_t size,
+                                 size_t initial_size, size_t chunk_size)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_SIGSEGV_RECOVERY
+  return sigsegv_stack_add_growable ((uintptr_t) start, size,
+                                     initial_size, chunk_size);
+#else
+  return (void *) 0;
+#endif
+}
+
+void *
+sigsegv_register_stack_zones (void *lo, void *hi,
+                              size_t yellow_size, size_t red_size,
+                              sigsegv_yellow_handler_t handler)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_SIGSEGV_RECOVERY
+  return sigsegv_stack_add_zones ((uintptr_t) lo, (uintptr_t) hi,
+                                  yellow_size, red_size, handler);
+#else
+  return (void *) 0;
+#endif
+}
+
+int
+sigsegv_stack_reguard (void *ticket)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY
+  volatile char dummy;
+
+  return sigsegv_stack_rearm_yellow ((struct registered_stack *) ticket,
+                                     (uintptr_t) &dummy);
+#else
+  return -1;
+#endif
+}
+
+size_t
+sigsegv_stack_size (void *ticket)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY
+  struct registered_stack *stack = (struct registered_stack *) ticket;
+
+  return stack->hi - stack->lo;
+#else
+  return 0;
+#endif
+}
+
+void
+sigsegv_unregister_stack (void *ticket)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY
+  sigsegv_stack_remove ((struct registered_stack *) ticket);
+#endif
+}
+
+void *
+stackoverflow_overflowed_stack (void)
+{
+#if HAVE_STACK_OVERFLOW_RECOVERY
+  return overflowed_stack;
+#else
+  return (void *) 0;
+#endif
+}
+
 void
 stackoverflow_deinstall_handler (void)
 {
@@ -571,7 +1743,7 @@ stackoverflow_deinstall_handler (void)
   stk_user_handler = (stackoverflow_handler_t) NULL;
 
 #if HAVE_SIGSEGV_RECOVERY
-  if (user_handler)
+  if (sigsegv_handlers_needed ())
     {
       /* Reinstall the signal handlers without SA_ONSTACK, to avoid Linux
          bug.  */
@@ -592,6 +1764,12 @@ stackoverflow_deinstall_handler (void)
     ss.ss_flags = SS_DISABLE;
     if (sigaltstack (&ss, (stack_t *) 0) < 0)
       perror ("libsigsegv (stackoverflow_deinstall_handler)");
+    else if (process_stack.pooled)
+      {
+        sigsegv_altstack_release ((void *) process_stack.extra_stack);
+        process_stack.extra_stack = 0;
+        process_stack.pooled = 0;
+      }
   }
 #endif
 
@@ -0,0 +1,448 @@
+/* Management of the protection of pages.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented: Windows has no mprotect().  */
+
+void *
+sigsegv_prot_register (sigsegv_dispatcher *dispatcher,
+                       void *address, size_t len, int prot,
+                       sigsegv_area_handler_t handler, void *handler_arg)
+{
+  return NULL;
+}
+
+void
+sigsegv_prot_unregister (void *ticket)
+{
+}
+
+int
+sigsegv_prot_set (void *ticket, void *address, size_t len, int prot)
+{
+  return -1;
+}
+
+int
+sigsegv_prot_get (void *ticket, void *address)
+{
+  return -1;
+}
+
+int
+sigsegv_prot_flush (void *ticket)
+{
+  return (ticket == NULL ? 0 : -1);
+}
+
+void
+sigsegv_prot_get_stats (sigsegv_prot_stats *stats)
+{
+  stats->mprotect_calls = 0;
+  stats->pages_changed = 0;
+  stats->runs = 0;
+  stats->vma_headroom = -1;
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if defined __linux__ || defined __ANDROID__
+# include <fcntl.h>
+#endif
+
+#include "atomic.h"
+
+/* Every area has two arrays with one byte per page: the protection that the
+   page has, and the protection that it should get.  The pages in which they
+   may differ lie in the interval [dirty_lo, dirty_hi).  A spin lock per area
+   protects these fields against concurrent sigsegv_prot_set and
+   sigsegv_prot_flush calls and faults in other threads.  */
+
+struct prot_area
+{
+  /* Link in the list of all areas.  */
+  struct prot_area *next;
+  sigsegv_dispatcher *dispatcher;
+  /* The ticket in the dispatcher.  */
+  void *ticket;
+  uintptr_t start;
+  size_t npages;
+  sigsegv_area_handler_t handler;
+  void *handler_arg;
+  /* A spin lock that protects the fields below.  */
+  volatile unsigned int lock;
+  /* The pages that may have pending changes.  */
+  size_t dirty_lo;
+  size_t dirty_hi;
+  unsigned char *applied;
+  unsigned char *wanted;
+};
+
+static uintptr_t pagesize;
+
+/* The list of all areas, and a spin lock that protects it.  */
+static struct prot_area *areas;
+static volatile unsigned int areas_lock;
+
+static volatile uintptr_t stat_mprotect_calls;
+static volatile uintptr_t stat_pages_changed;
+
+/* The lock of an area is taken after areas_lock, never before.  */
+
+static void
+spin_lock (volatile unsigned int *lock)
+{
+  while (!sv_atomic_compare_and_swap (lock, 0, 1))
+    ;
+}
+
+static void
+spin_unlock (volatile unsigned int *lock)
+{
+  sv_atomic_store (lock, 0);
+}
+
+/* Applies the pending changes of AREA.  Called with the lock of AREA held.
+   Returns the number of mprotect() calls made, or -1 if one failed.  */
+static int
+flush_area (struct prot_area *area)
+{
+  size_t i = area->dirty_lo;
+  size_t hi = area->dirty_hi;
+  int calls = 0;
+
+  while (i < hi)
+    {
+      unsigned char prot;
+      size_t j;
+      size_t changed;
+
+      if (area->wanted[i] == area->applied[i])
+        {
+          i++;
+          continue;
+        }
+      /* Extend the run over the following pages that should get the same
+         protection, whether they change or not.  Pages that don't change
+         make the call longer, but save a call when a page that changes
+         follows.  */
+      prot = area->wanted[i];
+      changed = 0;
+      for (j = i; j < hi && area->wanted[j] == prot; j++)
+        if (area->applied[j] != prot)
+          changed = j + 1 - i;
+      /* Don't extend the call past the last page that changes.  */
+      if (mprotect ((void *) (area->start + i * pagesize), changed * pagesize,
+                    prot) < 0)
+        {
+          area->dirty_lo = i;
+          return -1;
+        }
+      calls++;
+      sv_atomic_fetch_add (&stat_pages_changed, changed);
+      for (j = i; j < i + changed; j++)
+        area->applied[j] = prot;
+      i += changed;
+    }
+  area->dirty_lo = area->npages;
+  area->dirty_hi = 0;
+  if (calls > 0)
+    {
+      sv_atomic_fetch_add (&stat_mprotect_calls, calls);
+      sigsegv_vma_snapshot_invalidate ();
+    }
+  return calls;
+}
+
+/* Applies the pending change of page PAGE of AREA, together with the
+   adjacent pages that should get the same protection and don't have it yet.
+   Called with the lock of AREA held.  Returns 0, or -1 if mprotect()
+   failed.  */
+static int
+flush_run (struct prot_area *area, size_t page)
+{
+  unsigned char prot = area->wanted[page];
+  size_t lo = page;
+  size_t hi = page + 1;
+
+  while (lo > area->dirty_lo
+         && area->wanted[lo - 1] == prot && area->applied[lo - 1] != prot)
+    lo--;
+  while (hi < area->dirty_hi
+         && area->wanted[hi] == prot && area->applied[hi] != prot)
+    hi++;
+  if (mprotect ((void *) (area->start + lo * pagesize), (hi - lo) * pagesize,
+                prot) < 0)
+    return -1;
+  memset (area->applied + lo, prot, hi - lo);
+  sv_atomic_fetch_add (&stat_mprotect_calls, 1);
+  sv_atomic_fetch_add (&stat_pages_changed, hi - lo);
+  sigsegv_vma_snapshot_invalidate ();
+  return 0;
+}
+
+/* The area handler: applies the pending change of the faulting page, or
+   calls the area's handler.  */
+static int
+prot_area_handler (void *fault_address, void *arg)
+{
+  struct prot_area *area = (struct prot_area *) arg;
+  size_t page = ((uintptr_t) fault_address - area->start) / pagesize;
+  int ret = -1;
+
+  if (page >= area->npages)
+    return 0;
+  spin_lock (&area->lock);
+  if (area->wanted[page] != area->applied[page])
+    ret = (flush_run (area, page) == 0);
+  spin_unlock (&area->lock);
+  if (ret >= 0)
+    return ret;
+  return (*area->handler) (fault_address, area->handler_arg);
+}
+
+void *
+sigsegv_prot_register (sigsegv_dispatcher *dispatcher,
+                       void *address, size_t len, int prot,
+                       sigsegv_area_handler_t handler, void *handler_arg)
+{
+  struct prot_area *area;
+
+  if (pagesize == 0)
+    {
+#if HAVE_GETPAGESIZE
+      pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+      pagesize = sysconf (_SC_PAGESIZE);
+#else
+      pagesize = PAGESIZE;
+#endif
+    }
+  if (len == 0 || ((uintptr_t) address | len) & (pagesize - 1))
+    return NULL;
+
+  area = (struct prot_area *) malloc (sizeof (struct prot_area));
+  if (area == NULL)
+    return NULL;
+  area->npages = len / pagesize;
+  area->applied = (unsigned char *) malloc (2 * area->npages);
+  if (area->applied == NULL)
+    goto fail1;
+  area->wanted = area->applied + area->npages;
+  if (mprotect (address, len, prot) < 0)
+    goto fail2;
+  sigsegv_vma_snapshot_invalidate ();
+  memset (area->applied, prot, 2 * area->npages);
+  area->dispatcher = dispatcher;
+  area->start = (uintptr_t) address;
+  area->handler = handler;
+  area->handler_arg = handler_arg;
+  area->lock = 0;
+  area->dirty_lo = area->npages;
+  area->dirty_hi = 0;
+  area->ticket = sigsegv_register (dispatcher, address, len,
+                                   prot_area_handler, area);
+  if (area->ticket == NULL)
+    goto fail2;
+  sv_atomic_fetch_add (&stat_pages_changed, area->npages);
+  sv_atomic_fetch_add (&stat_mprotect_calls, 1);
+
+  spin_lock (&areas_lock);
+  area->next = areas;
+  areas = area;
+  spin_unlock (&areas_lock);
+  return area;
+
+ fail2:
+  free (area->applied);
+ fail1:
+  free (area);
+  return NULL;
+}
+
+void
+sigsegv_prot_unregister (void *ticket)
+{
+  struct prot_area *area = (struct prot_area *) ticket;
+  struct prot_area **p;
+
+  if (area == NULL)
+    return;
+  spin_lock (&areas_lock);
+  for (p = &areas; *p != NULL; p = &(*p)->next)
+    if (*p == area)
+      {
+        *p = area->next;
+        break;
+      }
+  spin_unlock (&areas_lock);
+  sigsegv_unregister (area->dispatcher, area->ticket);
+  free (area->applied);
+  free (area);
+}
+
+int
+sigsegv_prot_set (void *ticket, void *address, size_t len, int prot)
+{
+  struct prot_area *area = (struct prot_area *) ticket;
+  uintptr_t offset = (uintptr_t) address - area->start;
+  size_t lo, hi, i;
+
+  if (len == 0)
+    return 0;
+  if (offset >= area->npages * pagesize
+      || len > area->npages * pagesize - offset)
+    return -1;
+  lo = offset / pagesize;
+  hi = (offset + len - 1) / pagesize + 1;
+  spin_lock (&area->lock);
+  for (i = lo; i < hi; i++)
+    area->wanted[i] = prot;
+  if (lo < area->dirty_lo)
+    area->dirty_lo = lo;
+  if (hi > area->dirty_hi)
+    area->dirty_hi = hi;
+  spin_unlock (&area->lock);
+  return 0;
+}
+
+int
+sigsegv_prot_get (void *ticket, void *address)
+{
+  struct prot_area *area = (struct prot_area *) ticket;
+  uintptr_t offset = (uintptr_t) address - area->start;
+
+  if (offset >= area->npages * pagesize)
+    return -1;
+  return area->wanted[offset / pagesize];
+}
+
+int
+sigsegv_prot_flush (void *ticket)
+{
+  struct prot_area *area;
+  int calls = 0;
+
+  if (ticket != NULL)
+    {
+      area = (struct prot_area *) ticket;
+      spin_lock (&area->lock);
+      calls = flush_area (area);
+      spin_unlock (&area->lock);
+      return calls;
+    }
+  spin_lock (&areas_lock);
+  for (area = areas; area != NULL; area = area->next)
+    {
+      int ret;
+
+      spin_lock (&area->lock);
+      ret = flush_area (area);
+      spin_unlock (&area->lock);
+
+      if (ret < 0)
+        {
+          calls = -1;
+          break;
+        }
+      calls += ret;
+    }
+  spin_unlock (&areas_lock);
+  return calls;
+}
+
+#if defined __linux__ || defined __ANDROID__
+
+/* A callback for sigsegv_vma_iterate: counts the areas.  */
+static int
+count_vma (void *user_arg, const sigsegv_vma *vma)
+{
+  (*(long *) user_arg)++;
+  return 0;
+}
+
+/* Returns how many more VMAs the process may have, or -1 if not known.  */
+static long
+vma_headroom (void)
+{
+  static long max_map_count;
+  long count = 0;
+
+  if (max_map_count == 0)
+    {
+      char buf[32];
+      int fd = open ("/proc/sys/vm/max_map_count", O_RDONLY | O_CLOEXEC);
+      ssize_t n;
+
+      if (fd < 0)
+        return -1;
+      n = read (fd, buf, sizeof (buf) - 1);
+      close (fd);
+      if (n <= 0)
+        return -1;
+      buf[n] = '\0';
+      max_map_count = strtol (buf, NULL, 10);
+      if (max_map_count <= 0)
+        return -1;
+    }
+  if (sigsegv_vma_iterate (count_vma, &count, NULL, 0) < 0)
+    return -1;
+  return max_map_count - count;
+}
+
+#else
+
+# define vma_headroom() (-1L)
+
+#endif
+
+void
+sigsegv_prot_get_stats (sigsegv_prot_stats *stats)
+{
+  struct prot_area *area;
+  unsigned long runs = 0;
+
+  spin_lock (&areas_lock);
+  for (area = areas; area != NULL; area = area->next)
+    {
+      size_t i;
+
+      spin_lock (&area->lock);
+      for (i = 0; i < area->npages; i++)
+        if (i == 0 || area->applied[i] != area->applied[i - 1])
+          runs++;
+      spin_unlock (&area->lock);
+    }
+  spin_unlock (&areas_lock);
+  stats->mprotect_calls = sv_atomic_load (&stat_mprotect_calls);
+  stats->pages_changed = sv_atomic_load (&stat_pages_changed);
+  stats->runs = runs;
+  stats->vma_headroom = vma_headroom ();
+}
+
+#endif
@@ -0,0 +1,379 @@
+/* Safepoint polling page.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "safepoint.h"
+#include "threadreg.h"
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "atomic.h"
+
+/* The state of the safepoint is described by SAFEPOINT_EPOCH: it is odd
+   while the safepoint is armed, and even while it is disarmed.  Parked
+   threads wait until the epoch changes.  */
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented: the Windows handler does not park threads.  */
+
+void *
+sigsegv_safepoint_create (sigsegv_safepoint_handler_t handler)
+{
+  return NULL;
+}
+
+void
+sigsegv_safepoint_destroy (void)
+{
+}
+
+int
+sigsegv_safepoint_exists (void)
+{
+  return 0;
+}
+
+int
+sigsegv_safepoint_fault (void *fault_address, stackoverflow_context_t context,
+                         uintptr_t stack_pointer)
+{
+  return 0;
+}
+
+int
+sigsegv_safepoint_arm (void)
+{
+  return -1;
+}
+
+int
+sigsegv_safepoint_disarm (void)
+{
+  return -1;
+}
+
+unsigned int
+sigsegv_safepoint_parked_count (void)
+{
+  return 0;
+}
+
+int
+sigsegv_safepoint_wait (unsigned int count)
+{
+  return -1;
+}
+
+void
+sigsegv_safepoint_get_stats (sigsegv_safepoint_stats *stats)
+{
+  stats->parks = 0;
+  stats->total_time = 0;
+  stats->max_time = 0;
+}
+
+#else
+
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if !(HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS)
+# include <fcntl.h>
+#endif
+
+#if defined __linux__ && HAVE_LINUX_FUTEX_H
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# define USE_FUTEX 1
+#endif
+
+/* DragonFly BSD 3.8 still has only MAP_ANON and not MAP_ANONYMOUS.  */
+#if HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* The polling page.  */
+static char *volatile poll_page;
+static size_t poll_page_size;
+
+/* The user's safepoint handler.  */
+static sigsegv_safepoint_handler_t volatile safepoint_handler;
+
+/* Odd while armed, even while disarmed.  */
+static volatile unsigned int safepoint_epoch;
+
+/* One more than the disarmed epoch in which this thread last retried a
+   fault on the polling page, or 0.  */
+static SV_THREAD_LOCAL unsigned int retry_epoch;
+
+/* Number of threads currently parked.  */
+static volatile unsigned int parked_count;
+
+/* Incremented when a thread parks and when the safepoint is disarmed.
+   sigsegv_safepoint_wait waits for a change of it, so that it notices a
+   disarming even when no thread parks or unparks.  */
+static volatile unsigned int wait_events;
+
+/* The time when the safepoint was last armed, in nanoseconds.  */
+static volatile unsigned long long arm_time;
+
+/* Statistics.  */
+static volatile unsigned long stat_parks;
+static volatile unsigned long long stat_total_time;
+static volatile unsigned long long stat_max_time;
+
+/* Returns the current value of a monotonic clock, in nanoseconds, or 0 if
+   there is no such clock.  clock_gettime() is async-signal-safe.  */
+static unsigned long long
+monotonic_time (void)
+{
+#if HAVE_CLOCK_GETTIME && defined CLOCK_MONOTONIC
+  struct timespec ts;
+  if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+  return 0;
+}
+
+/* Waits until *P is no longer equal to VALUE, or until a spurious wakeup
+   occurs.  */
+static void
+wait_while_equal (volatile unsigned int *p, unsigned int value)
+{
+#if USE_FUTEX
+  syscall (SYS_futex, p, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#elif HAVE_NANOSLEEP
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = 50000;
+  if (sv_atomic_load (p) == value)
+    nanosleep (&ts, NULL);
+#else
+  /* Busy-wait.  */
+#endif
+}
+
+/* Wakes up all threads waiting in wait_while_equal (P, ...).  */
+static void
+wake_all (volatile unsigned int *p)
+{
+#if USE_FUTEX
+  syscall (SYS_futex, p, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+void *
+sigsegv_safepoint_create (sigsegv_safepoint_handler_t handler)
+{
+  if (poll_page == NULL)
+    {
+      size_t pagesize;
+      void *page;
+
+#if HAVE_GETPAGESIZE
+      pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+      pagesize = sysconf (_SC_PAGESIZE);
+#else
+      pagesize = PAGESIZE;
+#endif
+#if HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS
+      page = mmap (NULL, pagesize, PROT_READ, MAP_ANONYMOUS | MAP_PRIVATE,
+                   -1, 0);
+#else
+      {
+        int fd = open ("/dev/zero", O_RDONLY, 0644);
+        if (fd < 0)
+          return NULL;
+        page = mmap (NULL, pagesize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close (fd);
+      }
+#endif
+      if (page == (void *) -1)
+        return NULL;
+      sigsegv_vma_snapshot_invalidate ();
+      poll_page_size = pagesize;
+      safepoint_epoch = 0;
+      parked_count = 0;
+      stat_parks = 0;
+      stat_total_time = 0;
+      stat_max_time = 0;
+      sv_atomic_store (&poll_page, (char *) page);
+    }
+  safepoint_handler = handler;
+  return poll_page;
+}
+
+void
+sigsegv_safepoint_destroy (void)
+{
+  char *page = poll_page;
+
+  if (page != NULL)
+    {
+      sigsegv_safepoint_disarm ();
+      sv_atomic_store (&poll_page, (char *) NULL);
+      safepoint_handler = (sigsegv_safepoint_handler_t) NULL;
+      munmap (page, poll_page_size);
+      sigsegv_vma_snapshot_invalidate ();
+    }
+}
+
+int
+sigsegv_safepoint_exists (void)
+{
+  return poll_page != NULL;
+}
+
+int
+sigsegv_safepoint_fault (void *fault_address, stackoverflow_context_t context,
+                         uintptr_t stack_pointer)
+{
+  char *page = sv_atomic_load (&poll_page);
+  uintptr_t addr = (uintptr_t) fault_address;
+  unsigned int epoch;
+  int saved_errno;
+
+  if (page == NULL
+      || !(addr >= (uintptr_t) page
+           && addr - (uintptr_t) page < poll_page_size))
+    return 0;
+
+  saved_errno = errno;
+  epoch = sv_atomic_load (&safepoint_epoch);
+  if (epoch & 1)
+    {
+      /* The safepoint is armed.  Account for the time it took us to get
+         here.  */
+      unsigned long long now = monotonic_time ();
+      unsigned long long armed = arm_time;
+      unsigned long long delay = (now > armed ? now - armed : 0);
+      unsigned long long max;
+
+      sv_atomic_fetch_add (&stat_parks, 1);
+      sv_atomic_fetch_add (&stat_total_time, delay);
+      while (max = stat_max_time, delay > max)
+        if (sv_atomic_compare_and_swap (&stat_max_time, max, delay))
+          break;
+
+      if (safepoint_handler != NULL)
+        (*safepoint_handler) (delay, context);
+
+      /* Park until the safepoint is disarmed.  The part of the stack in use
+         is recorded before the thread is counted as parked.  */
+      sigsegv_thread_park (stack_pointer);
+      sv_atomic_fetch_add (&parked_count, 1);
+      sv_atomic_fetch_add (&wait_events, 1);
+      wake_all (&wait_events);
+      while (sv_atomic_load (&safepoint_epoch) == epoch)
+        wait_while_equal (&safepoint_epoch, epoch);
+      sigsegv_thread_unpark ();
+      sv_atomic_fetch_add (&parked_count, (unsigned int) -1);
+    }
+  else
+    {
+      /* The safepoint is disarmed.  If it was disarmed between our poll and
+         now, retrying the poll succeeds.  If the same access faults again
+         in the same epoch, it is not a poll (e.g. a write to the page), and
+         the other handlers should see it.  */
+      if (retry_epoch == epoch + 1)
+        {
+          retry_epoch = 0;
+          return 0;
+        }
+      retry_epoch = epoch + 1;
+    }
+  errno = saved_errno;
+  return 1;
+}
+
+int
+sigsegv_safepoint_arm (void)
+{
+  char *page = poll_page;
+
+  if (page == NULL)
+    return -1;
+  if (!(safepoint_epoch & 1))
+    {
+      arm_time = monotonic_time ();
+      sv_atomic_fetch_add (&safepoint_epoch, 1);
+      if (mprotect (page, poll_page_size, PROT_NONE) < 0)
+        {
+          sv_atomic_fetch_add (&safepoint_epoch, 1);
+          return -1;
+        }
+      sigsegv_vma_snapshot_invalidate ();
+    }
+  return 0;
+}
+
+int
+sigsegv_safepoint_disarm (void)
+{
+  char *page = poll_page;
+
+  if (page == NULL)
+    return -1;
+  if (safepoint_epoch & 1)
+    {
+      if (mprotect (page, poll_page_size, PROT_READ) < 0)
+        return -1;
+      sigsegv_vma_snapshot_invalidate ();
+      sv_atomic_fetch_add (&safepoint_epoch, 1);
+      wake_all (&safepoint_epoch);
+      sv_atomic_fetch_add (&wait_events, 1);
+      wake_all (&wait_events);
+    }
+  return 0;
+}
+
+unsigned int
+sigsegv_safepoint_parked_count (void)
+{
+  return sv_atomic_load (&parked_count);
+}
+
+int
+sigsegv_safepoint_wait (unsigned int count)
+{
+  for (;;)
+    {
+      unsigned int events = sv_atomic_load (&wait_events);
+
+      if (poll_page == NULL || !(sv_atomic_load (&safepoint_epoch) & 1))
+        return -1;
+      if (sv_atomic_load (&parked_count) >= count)
+        return 0;
+      wait_while_equal (&wait_events, events);
+    }
+}
+
+void
+sigsegv_safepoint_get_stats (sigsegv_safepoint_stats *stats)
+{
+  stats->parks = sv_atomic_load (&stat_parks);
+  stats->total_time = sv_atomic_load (&stat_total_time);
+  stats->max_time = sv_atomic_load (&stat_max_time);
+}
+
+#endif
@@ -0,0 +1,44 @@
+/* Safepoint polling page.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _SAFEPOINT_H
+#define _SAFEPOINT_H
+
+#include <stdint.h>
+
+/* Allocates the polling page and remembers the handler.
+   Returns the address of the polling page, or NULL upon failure.  */
+extern void *sigsegv_safepoint_create (sigsegv_safepoint_handler_t handler);
+
+/* Disarms the safepoint and frees the polling page.  */
+extern void sigsegv_safepoint_destroy (void);
+
+/* Returns nonzero if the polling page exists.  */
+extern int sigsegv_safepoint_exists (void);
+
+/* Called by the fault handler, before any other handler.
+   If FAULT_ADDRESS lies in the polling page, parks the calling thread until
+   the safepoint is disarmed and returns 1; the faulting load can then be
+   restarted.  If the safepoint is disarmed, returns 1 once, so that a poll
+   that raced with the disarming is retried, and 0 if the same thread faults
+   there again before the next arming.  Otherwise returns 0.
+   STACK_POINTER is the stack pointer of the thread at the fault, or 0 if
+   unknown.  */
+extern int sigsegv_safepoint_fault (void *fault_address,
+                                    stackoverflow_context_t context,
+                                    uintptr_t stack_pointer);
+
+#endif /* _SAFEPOINT_H */
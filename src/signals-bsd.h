@@ -30,3 +30,8 @@
       var = SIGBUS; { body }               \
     }
 #endif
+
+/* List of signals that are sent synchronously when an instruction traps:
+   illegal and breakpoint instructions, arithmetic exceptions.  */
+#define SIGSEGV_FOR_ALL_TRAP_SIGNALS(var,body) \
+  { int var; var = SIGILL; { body } var = SIGFPE; { body } var = SIGTRAP; { body } }
@@ -21,3 +21,8 @@
    stack overflow gives a SIGSEGV.  */
 #define SIGSEGV_FOR_ALL_SIGNALS(var,body) \
   { int var; var = SIGSEGV; { body } var = SIGBUS; { body } }
+
+/* List of signals that are sent synchronously when an instruction traps:
+   illegal and breakpoint instructions, arithmetic exceptions.  */
+#define SIGSEGV_FOR_ALL_TRAP_SIGNALS(var,body) \
+  { int var; var = SIGILL; { body } var = SIGFPE; { body } var = SIGTRAP; { body } }
@@ -0,0 +1,560 @@
+/* Registry of stacks that are not thread stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "stackreg.h"
+
+#include <stdlib.h>
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented: the Windows handler detects stack overflow through the
+   system's own guard pages.  */
+
+struct registered_stack *
+sigsegv_stack_add (uintptr_t lo, uintptr_t hi, size_t guard)
+{
+  return NULL;
+}
+
+struct registered_stack *
+sigsegv_stack_add_growable (uintptr_t start, size_t size,
+                            size_t initial_size, size_t chunk_size)
+{
+  return NULL;
+}
+
+int
+sigsegv_stack_grow (struct registered_stack *stack)
+{
+  return -1;
+}
+
+struct registered_stack *
+sigsegv_stack_add_zones (uintptr_t lo, uintptr_t hi,
+                         size_t yellow_size, size_t red_size,
+                         sigsegv_yellow_handler_t handler)
+{
+  return NULL;
+}
+
+int
+sigsegv_stack_disarm_yellow (struct registered_stack *stack, uintptr_t addr)
+{
+  return -1;
+}
+
+int
+sigsegv_stack_rearm_yellow (struct registered_stack *stack, uintptr_t sp)
+{
+  return -1;
+}
+
+void
+sigsegv_stack_remove (struct registered_stack *stack)
+{
+}
+
+struct registered_stack *
+sigsegv_stack_find_guard (uintptr_t addr)
+{
+  return NULL;
+}
+
+#else
+
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if !(HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS)
+# include <fcntl.h>
+#endif
+
+#include "atomic.h"
+
+/* DragonFly BSD 3.8 still has only MAP_ANON and not MAP_ANONYMOUS.  */
+#if HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* The guard areas are indexed by a three-level table, like a page table,
+   that maps every granule of a guard area to its registered_stack.  The
+   fault handler walks the table without taking a lock.  Registering a stack
+   costs a few stores per granule of its guard area.  Table levels are never
+   freed, and registered_stack structs are recycled but never freed, so that
+   the fault handler never follows a dangling pointer.  */
+
+#define GRANULE_SHIFT 12
+#define GRANULE_BITS (sizeof (uintptr_t) * CHAR_BIT - GRANULE_SHIFT)
+#define LEVEL_BITS ((GRANULE_BITS + 2) / 3)
+#define LEVEL_SIZE ((uintptr_t) 1 << LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SIZE - 1)
+#define TOP_SIZE ((uintptr_t) 1 << (GRANULE_BITS - 2 * LEVEL_BITS))
+
+/* The address of the top level.  Each level is an array of uintptr_t; the
+   entries of the top and middle levels point to tables of the next level,
+   the entries of the last level point to registered_stack structs.  */
+static volatile uintptr_t top_level;
+
+static uintptr_t pagesize;
+
+/* The registered_stack structs that are not in use.  */
+static struct registered_stack *free_stacks;
+
+/* A spin lock that protects free_stacks.  */
+static volatile unsigned int registry_lock;
+
+static void
+lock_registry (void)
+{
+  while (!sv_atomic_compare_and_swap (&registry_lock, 0, 1))
+    ;
+}
+
+static void
+unlock_registry (void)
+{
+  sv_atomic_store (&registry_lock, 0);
+}
+
+/* Allocates a zero-filled table of N entries.  Returns NULL upon failure.  */
+static volatile uintptr_t *
+allocate_table (uintptr_t n)
+{
+  void *table;
+
+#if HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS
+  table = mmap (NULL, n * sizeof (uintptr_t), PROT_READ | PROT_WRITE,
+                MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+#else
+  {
+    int fd = open ("/dev/zero", O_RDONLY, 0644);
+    if (fd < 0)
+      return NULL;
+    table = mmap (NULL, n * sizeof (uintptr_t), PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE, fd, 0);
+    close (fd);
+  }
+#endif
+  if (table == (void *) -1)
+    return NULL;
+  sigsegv_vma_snapshot_invalidate ();
+  return (volatile uintptr_t *) table;
+}
+
+/* Installs a new table of N entries in *SLOT, unless another thread did so
+   first.  Returns the table in *SLOT, or NULL upon failure.  */
+static volatile uintptr_t *
+install_table (volatile uintptr_t *slot, uintptr_t n)
+{
+  volatile uintptr_t *table = allocate_table (n);
+
+  if (table == NULL)
+    return NULL;
+  if (!sv_atomic_compare_and_swap (slot, 0, (uintptr_t) table))
+    {
+      munmap ((void *) table, n * sizeof (uintptr_t));
+      table = (volatile uintptr_t *) sv_atomic_load (slot);
+    }
+  return table;
+}
+
+/* Returns the address of the last-level entry for granule G, allocating
+   the tables on the way if ALLOCATE is nonzero.  Returns NULL if there is
+   no such entry.  This function does not take locks, because it is also
+   called by the fault handler when a growable stack grows.  */
+static volatile uintptr_t *
+find_entry (uintptr_t g, int allocate)
+{
+  volatile uintptr_t *table =
+    (volatile uintptr_t *) sv_atomic_load (&top_level);
+  uintptr_t indices[2];
+  unsigned int level;
+
+  if (table == NULL)
+    {
+      if (!allocate
+          || (table = install_table (&top_level, TOP_SIZE)) == NULL)
+        return NULL;
+    }
+  indices[0] = g >> (2 * LEVEL_BITS);
+  indices[1] = (g >> LEVEL_BITS) & LEVEL_MASK;
+  for (level = 0; level < 2; level++)
+    {
+      volatile uintptr_t *next =
+        (volatile uintptr_t *) sv_atomic_load (&table[indices[level]]);
+
+      if (next == NULL)
+        {
+          if (!allocate
+              || (next = install_table (&table[indices[level]], LEVEL_SIZE))
+                 == NULL)
+            return NULL;
+        }
+      table = next;
+    }
+  return &table[g & LEVEL_MASK];
+}
+
+/* Makes the entries for the granules of [START, END) point to STACK.
+   Returns 0 or -1.  */
+static int
+set_entries (uintptr_t start, uintptr_t end, struct registered_stack *stack)
+{
+  uintptr_t g;
+
+  for (g = start >> GRANULE_SHIFT; g <= (end - 1) >> GRANULE_SHIFT; g++)
+    {
+      volatile uintptr_t *entry = find_entry (g, 1);
+
+      if (entry == NULL)
+        return -1;
+      sv_atomic_store (entry, (uintptr_t) stack);
+    }
+  return 0;
+}
+
+/* Clears the entries for the granules of [START, END) that point to STACK,
+   except for the granules of [KEEP_START, KEEP_END).  Granules that are
+   shared with the guard area of another stack may point to that stack.  */
+static void
+clear_entries (uintptr_t start, uintptr_t end, struct registered_stack *stack,
+               uintptr_t keep_start, uintptr_t keep_end)
+{
+  uintptr_t g;
+
+  if (start >= end)
+    return;
+  for (g = start >> GRANULE_SHIFT; g <= (end - 1) >> GRANULE_SHIFT; g++)
+    if (!(keep_start < keep_end
+          && g >= keep_start >> GRANULE_SHIFT
+          && g <= (keep_end - 1) >> GRANULE_SHIFT))
+      {
+        volatile uintptr_t *entry = find_entry (g, 0);
+
+        if (entry != NULL)
+          sv_atomic_compare_and_swap (entry, (uintptr_t) stack, 0);
+      }
+}
+
+/* Sets the guard area of STACK, which is either empty or the one that
+   its entries point to, to [START, END).  Returns 0 or -1.  */
+static int
+move_guard (struct registered_stack *stack, uintptr_t start, uintptr_t end)
+{
+  uintptr_t old_start = stack->guard_start;
+  uintptr_t old_end = stack->guard_end;
+
+  if (set_entries (start, end, stack) < 0)
+    {
+      clear_entries (start, end, stack, old_start, old_end);
+      return -1;
+    }
+  stack->guard_start = start;
+  stack->guard_end = end;
+  clear_entries (old_start, old_end, stack, start, end);
+  return 0;
+}
+
+static void
+init_pagesize (void)
+{
+#if HAVE_GETPAGESIZE
+  pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+  pagesize = sysconf (_SC_PAGESIZE);
+#else
+  pagesize = PAGESIZE;
+#endif
+}
+
+/* Allocates a registered_stack struct.  Returns NULL upon failure.  */
+static struct registered_stack *
+new_stack (void)
+{
+  struct registered_stack *stack;
+
+  lock_registry ();
+  stack = free_stacks;
+  if (stack != NULL)
+    free_stacks = stack->next_free;
+  unlock_registry ();
+  if (stack == NULL)
+    stack = (struct registered_stack *) malloc (sizeof (struct registered_stack));
+  return stack;
+}
+
+/* Puts STACK on the list of free structs.  */
+static void
+free_stack (struct registered_stack *stack)
+{
+  lock_registry ();
+  stack->next_free = free_stacks;
+  free_stacks = stack;
+  unlock_registry ();
+}
+
+struct registered_stack *
+sigsegv_stack_add (uintptr_t lo, uintptr_t hi, size_t guard)
+{
+  struct registered_stack *stack;
+
+  if (!(lo < hi) || guard == 0)
+    return NULL;
+  /* The guard area must not wrap around the address space.  */
+#if STACK_DIRECTION < 0
+  if (guard > lo)
+    return NULL;
+#else
+  if (hi + guard < hi)
+    return NULL;
+#endif
+  stack = new_stack ();
+  if (stack == NULL)
+    return NULL;
+  stack->lo = lo;
+  stack->hi = hi;
+  stack->chunk = 0;
+  stack->yellow_end = 0;
+  stack->guard_start = 0;
+  stack->guard_end = 0;
+#if STACK_DIRECTION < 0
+  if (move_guard (stack, lo - guard, lo) < 0)
+#else
+  if (move_guard (stack, hi, hi + guard) < 0)
+#endif
+    {
+      free_stack (stack);
+      return NULL;
+    }
+  return stack;
+}
+
+/* Returns the guard area of the growable stack STACK: the part of the
+   reserved region, at most one chunk, next to the growing end.  */
+#if STACK_DIRECTION < 0
+# define growable_guard_start(stack) \
+   ((stack)->lo - (stack)->reserved_start > (stack)->chunk \
+    ? (stack)->lo - (stack)->chunk : (stack)->reserved_start)
+# define growable_guard_end(stack) ((stack)->lo)
+#else
+# define growable_guard_start(stack) ((stack)->hi)
+# define growable_guard_end(stack) \
+   ((stack)->reserved_end - (stack)->hi > (stack)->chunk \
+    ? (stack)->hi + (stack)->chunk : (stack)->reserved_end)
+#endif
+
+struct registered_stack *
+sigsegv_stack_add_growable (uintptr_t start, size_t size,
+                            size_t initial_size, size_t chunk_size)
+{
+  struct registered_stack *stack;
+
+  if (pagesize == 0)
+    init_pagesize ();
+  initial_size = (initial_size + pagesize - 1) & -pagesize;
+  chunk_size = (chunk_size + pagesize - 1) & -pagesize;
+  if ((start & (pagesize - 1)) != 0 || initial_size == 0 || chunk_size == 0
+      || size < initial_size + pagesize)
+    return NULL;
+
+  stack = new_stack ();
+  if (stack == NULL)
+    return NULL;
+  stack->reserved_start = start;
+  stack->reserved_end = start + size;
+  stack->chunk = chunk_size;
+  stack->yellow_end = 0;
+#if STACK_DIRECTION < 0
+  stack->hi = start + size;
+  stack->lo = stack->hi - initial_size;
+  stack->limit = start + pagesize;
+#else
+  stack->lo = start;
+  stack->hi = start + initial_size;
+  stack->limit = start + size - pagesize;
+#endif
+  stack->guard_start = 0;
+  stack->guard_end = 0;
+  if (mprotect ((void *) stack->lo, initial_size, PROT_READ | PROT_WRITE) < 0
+      || move_guard (stack, growable_guard_start (stack),
+                     growable_guard_end (stack)) < 0)
+    {
+      free_stack (stack);
+      return NULL;
+    }
+  sigsegv_vma_snapshot_invalidate ();
+  return stack;
+}
+
+int
+sigsegv_stack_grow (struct registered_stack *stack)
+{
+#if STACK_DIRECTION < 0
+  uintptr_t new_lo;
+
+  if (stack->chunk == 0 || stack->lo <= stack->limit)
+    return -1;
+  new_lo = (stack->lo - stack->limit > stack->chunk
+            ? stack->lo - stack->chunk : stack->limit);
+  if (mprotect ((void *) new_lo, stack->lo - new_lo, PROT_READ | PROT_WRITE)
+      < 0)
+    return -1;
+  stack->lo = new_lo;
+#else
+  uintptr_t new_hi;
+
+  if (stack->chunk == 0 || stack->hi >= stack->limit)
+    return -1;
+  new_hi = (stack->limit - stack->hi > stack->chunk
+            ? stack->hi + stack->chunk : stack->limit);
+  if (mprotect ((void *) stack->hi, new_hi - stack->hi, PROT_READ | PROT_WRITE)
+      < 0)
+    return -1;
+  stack->hi = new_hi;
+#endif
+  /* If the guard area cannot be moved, the stack keeps its size in the
+     registry, and the next fault in the new part is an overflow.  */
+  move_guard (stack, growable_guard_start (stack), growable_guard_end (stack));
+  sigsegv_vma_snapshot_invalidate ();
+  return 0;
+}
+
+struct registered_stack *
+sigsegv_stack_add_zones (uintptr_t lo, uintptr_t hi,
+                         size_t yellow_size, size_t red_size,
+                         sigsegv_yellow_handler_t handler)
+{
+  struct registered_stack *stack;
+  uintptr_t guard_start;
+  uintptr_t guard_end;
+
+  if (pagesize == 0)
+    init_pagesize ();
+  yellow_size = (yellow_size + pagesize - 1) & -pagesize;
+  red_size = (red_size + pagesize - 1) & -pagesize;
+  if (yellow_size == 0)
+    return NULL;
+
+  stack = new_stack ();
+  if (stack == NULL)
+    return NULL;
+  stack->lo = lo;
+  stack->hi = hi;
+  stack->chunk = 0;
+#if STACK_DIRECTION < 0
+  if ((lo & (pagesize - 1)) != 0)
+    goto fail;
+  stack->yellow_start = lo - yellow_size;
+  stack->yellow_end = lo;
+  guard_start = stack->yellow_start - red_size;
+  guard_end = lo;
+#else
+  if ((hi & (pagesize - 1)) != 0)
+    goto fail;
+  stack->yellow_start = hi;
+  stack->yellow_end = hi + yellow_size;
+  guard_start = hi;
+  guard_end = stack->yellow_end + red_size;
+#endif
+  stack->yellow_armed = 1;
+  stack->yellow_handler = handler;
+  stack->guard_start = 0;
+  stack->guard_end = 0;
+  if (mprotect ((void *) guard_start, guard_end - guard_start, PROT_NONE) < 0
+      || move_guard (stack, guard_start, guard_end) < 0)
+    goto fail;
+  sigsegv_vma_snapshot_invalidate ();
+  return stack;
+
+ fail:
+  free_stack (stack);
+  return NULL;
+}
+
+int
+sigsegv_stack_disarm_yellow (struct registered_stack *stack, uintptr_t addr)
+{
+  if (!(stack->yellow_armed
+        && addr >= stack->yellow_start && addr < stack->yellow_end))
+    return -1;
+  if (mprotect ((void *) stack->yellow_start,
+                stack->yellow_end - stack->yellow_start,
+                PROT_READ | PROT_WRITE) < 0)
+    return -1;
+  sigsegv_vma_snapshot_invalidate ();
+  stack->yellow_armed = 0;
+  return 0;
+}
+
+int
+sigsegv_stack_rearm_yellow (struct registered_stack *stack, uintptr_t sp)
+{
+  if (stack->yellow_end == 0)
+    return -1;
+  if (stack->yellow_armed)
+    return 0;
+  /* The frames in the zone must be dead.  */
+  if (sp >= stack->yellow_start - pagesize && sp < stack->yellow_end + pagesize)
+    return -1;
+  if (mprotect ((void *) stack->yellow_start,
+                stack->yellow_end - stack->yellow_start, PROT_NONE) < 0)
+    return -1;
+  sigsegv_vma_snapshot_invalidate ();
+  stack->yellow_armed = 1;
+  return 0;
+}
+
+void
+sigsegv_stack_remove (struct registered_stack *stack)
+{
+  uintptr_t guard_start;
+  uintptr_t guard_end;
+
+  if (stack == NULL)
+    return;
+  guard_start = stack->guard_start;
+  guard_end = stack->guard_end;
+  clear_entries (guard_start, guard_end, stack, 0, 0);
+  if (stack->yellow_end != 0 && guard_start < guard_end)
+    {
+      /* We made the yellow and red zones inaccessible.  Undo it.  */
+      mprotect ((void *) guard_start, guard_end - guard_start,
+                PROT_READ | PROT_WRITE);
+      sigsegv_vma_snapshot_invalidate ();
+    }
+  free_stack (stack);
+}
+
+struct registered_stack *
+sigsegv_stack_find_guard (uintptr_t addr)
+{
+  volatile uintptr_t *entry = find_entry (addr >> GRANULE_SHIFT, 0);
+  struct registered_stack *stack;
+
+  if (entry == NULL)
+    return NULL;
+  stack = (struct registered_stack *) sv_atomic_load (entry);
+  if (stack != NULL
+      && addr >= stack->guard_start && addr < stack->guard_end)
+    return stack;
+  return NULL;
+}
+
+#endif
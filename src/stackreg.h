@@ -0,0 +1,96 @@
+/* Registry of stacks that are not thread stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _STACKREG_H
+#define _STACKREG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sigsegv.h"
+
+/* A registered stack.  The ticket of the stack is a pointer to it.  */
+struct registered_stack
+{
+  /* The stack is [lo, hi).  */
+  uintptr_t lo;
+  uintptr_t hi;
+  /* The guard area beyond its growing end.  */
+  uintptr_t guard_start;
+  uintptr_t guard_end;
+  /* For a growable stack: the amount by which it grows, the reserved
+     region in which it grows, and the limit up to which it can grow.
+     For other stacks, chunk is 0.  */
+  size_t chunk;
+  uintptr_t reserved_start;
+  uintptr_t reserved_end;
+  uintptr_t limit;
+  /* For a stack with zones: the yellow zone, which is the part of the guard
+     area next to the stack, whether it is protected, and the handler that
+     is called when it is hit.  The rest of the guard area is the red zone.
+     For other stacks, yellow_end is 0.  */
+  uintptr_t yellow_start;
+  uintptr_t yellow_end;
+  volatile int yellow_armed;
+  sigsegv_yellow_handler_t yellow_handler;
+  /* Link in the list of free structs.  */
+  struct registered_stack *next_free;
+};
+
+/* Registers the stack [LO, HI) with a guard area of GUARD bytes.
+   Returns a ticket, or NULL upon failure.  */
+extern struct registered_stack *sigsegv_stack_add (uintptr_t lo, uintptr_t hi,
+                                                   size_t guard);
+
+/* Registers a growable stack in the reserved region [START, START+SIZE).
+   Makes INITIAL_SIZE bytes at its top accessible.  Returns a ticket, or NULL
+   upon failure.  */
+extern struct registered_stack *
+       sigsegv_stack_add_growable (uintptr_t start, size_t size,
+                                   size_t initial_size, size_t chunk_size);
+
+/* Grows the growable stack STACK by one chunk, and moves its guard area.
+   Returns 0, or -1 if the stack has reached its limit or cannot grow.
+   Must only be called by the thread that runs on the stack.  */
+extern int sigsegv_stack_grow (struct registered_stack *stack);
+
+/* Registers the stack [LO, HI) with a yellow zone of YELLOW_SIZE bytes and
+   a red zone of RED_SIZE bytes beyond it, and protects both zones.
+   Returns a ticket, or NULL upon failure.  */
+extern struct registered_stack *
+       sigsegv_stack_add_zones (uintptr_t lo, uintptr_t hi,
+                                size_t yellow_size, size_t red_size,
+                                sigsegv_yellow_handler_t handler);
+
+/* If ADDR lies in the protected yellow zone of STACK, unprotects the zone
+   and returns 0.  Otherwise returns -1.  */
+extern int sigsegv_stack_disarm_yellow (struct registered_stack *stack,
+                                        uintptr_t addr);
+
+/* Protects the yellow zone of STACK again, unless SP lies in the zone or
+   within a page of it.  Returns 0 or -1.  */
+extern int sigsegv_stack_rearm_yellow (struct registered_stack *stack,
+                                       uintptr_t sp);
+
+/* Unregisters a stack.  Makes the yellow and red zones of a stack of
+   sigsegv_stack_add_zones accessible again.  */
+extern void sigsegv_stack_remove (struct registered_stack *stack);
+
+/* Returns the registered stack whose guard area contains ADDR, or NULL.
+   This function is async-signal-safe and does not take locks.  */
+extern struct registered_stack *sigsegv_stack_find_guard (uintptr_t addr);
+
+#endif /* _STACKREG_H */
@@ -0,0 +1,360 @@
+/* Measuring and trimming the stack usage of a thread.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "stackreg.h"
+#include "stackuse.h"
+#include "threadreg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The limit for sigsegv_stack_remaining, when there is none.  */
+#if STACK_DIRECTION > 0
+# define NO_STACK_LIMIT ((size_t) -1)
+#else
+# define NO_STACK_LIMIT 0
+#endif
+
+/* The limit of the stack that the calling thread runs on.  */
+#if SIGSEGV_INLINE_STACK_REMAINING
+__thread size_t sigsegv_thread_stack_limit = NO_STACK_LIMIT;
+#else
+static SV_THREAD_LOCAL size_t sigsegv_thread_stack_limit = NO_STACK_LIMIT;
+
+size_t
+sigsegv_stack_remaining (void)
+{
+  volatile char here;
+
+# if STACK_DIRECTION > 0
+  return sigsegv_thread_stack_limit - (size_t) &here;
+# else
+  return (size_t) &here - sigsegv_thread_stack_limit;
+# endif
+}
+#endif
+
+/* The limit of the calling thread's own stack.  */
+static SV_THREAD_LOCAL size_t own_stack_limit = NO_STACK_LIMIT;
+
+void
+sigsegv_set_thread_stack_limit (uintptr_t limit)
+{
+  own_stack_limit = (limit != 0 ? limit : NO_STACK_LIMIT);
+  sigsegv_thread_stack_limit = own_stack_limit;
+}
+
+void
+sigsegv_enter_stack (void *ticket)
+{
+  struct registered_stack *stack = (struct registered_stack *) ticket;
+
+  if (stack == NULL)
+    {
+      sigsegv_thread_stack_limit = own_stack_limit;
+      sigsegv_thread_set_stack (0, 0, 0);
+    }
+  else
+    {
+      uintptr_t base;
+      uintptr_t mapped;
+
+#if STACK_DIRECTION > 0
+      base = stack->lo;
+      mapped = stack->hi;
+#else
+      base = stack->hi;
+      mapped = stack->lo;
+#endif
+      if (stack->chunk != 0)
+        /* A growable stack can grow up to its limit.  */
+        sigsegv_thread_stack_limit = stack->limit;
+      else
+        sigsegv_thread_stack_limit = mapped;
+      sigsegv_thread_set_stack (base, sigsegv_thread_stack_limit, mapped);
+    }
+}
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented.  */
+
+size_t
+sigsegv_stack_high_water (void)
+{
+  return 0;
+}
+
+int
+sigsegv_stack_trim (void)
+{
+  return -1;
+}
+
+unsigned int
+sigsegv_thread_stack_high_water (size_t *marks, unsigned int max)
+{
+  return 0;
+}
+
+int
+sigsegv_thread_stack_trim (void)
+{
+  return -1;
+}
+
+#else
+
+/* Persuade Solaris OpenIndiana <unistd.h> to declare mincore().  */
+#define __EXTENSIONS__ 1
+
+#include "stackvma.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+/* The stack of the calling thread is the virtual memory area that contains
+   a local variable.  Its pages beyond the stack pointer (below it on most
+   platforms) were touched by deeper calls in the past; the pages that are
+   still resident tell how deep the stack has ever been.  */
+
+/* The AIX declaration of mincore() uses 'caddr_t', whereas the other platforms
+   use 'void *'. */
+#ifdef _AIX
+typedef caddr_t MINCORE_ADDR_T;
+#else
+typedef void* MINCORE_ADDR_T;
+#endif
+
+/* The glibc and musl declaration of mincore() uses 'unsigned char *', whereas
+   the BSD declaration uses 'char *'.  */
+#if __GLIBC__ >= 2 || defined __linux__ || defined __ANDROID__
+typedef unsigned char pageinfo_t;
+#else
+typedef char pageinfo_t;
+#endif
+
+/* The number of pages that mincore() examines at once.  */
+#define MINCORE_BATCH 256
+
+/* The number of pages beyond the page of the stack pointer that
+   sigsegv_stack_trim keeps, for the frames of the functions it calls.  */
+#define TRIM_KEEP_PAGES 2
+
+static uintptr_t pagesize;
+
+static void
+init_pagesize (void)
+{
+#if HAVE_GETPAGESIZE
+  pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+  pagesize = sysconf (_SC_PAGESIZE);
+#else
+  pagesize = PAGESIZE;
+#endif
+}
+
+/* Returns the high-water mark of the stack whose VMA contains INSIDE, not
+   looking at the pages from the page of SP to the top.  */
+static size_t
+high_water (uintptr_t inside, uintptr_t sp)
+{
+#if HAVE_STACKVMA && HAVE_MINCORE
+  struct vma_struct vma;
+  pageinfo_t vec[MINCORE_BATCH];
+  uintptr_t addr;
+
+  if (pagesize == 0)
+    init_pagesize ();
+  if (sigsegv_get_vma (inside, &vma) < 0)
+    return 0;
+# if STACK_DIRECTION < 0
+  /* Find the lowest resident page, from the low end up to the page of SP.  */
+  for (addr = vma.start; addr < (sp & -pagesize); )
+    {
+      uintptr_t count = ((sp & -pagesize) - addr) / pagesize;
+      uintptr_t i;
+
+      if (count > MINCORE_BATCH)
+        count = MINCORE_BATCH;
+      if (mincore ((MINCORE_ADDR_T) addr, count * pagesize, vec) < 0)
+        return 0;
+      for (i = 0; i < count; i++)
+        if (vec[i] & 1)
+          return vma.end - (addr + i * pagesize);
+      addr += count * pagesize;
+    }
+  return vma.end - (sp & -pagesize);
+# else
+  /* Find the highest resident page, from the high end down to the page
+     after the one of SP.  */
+  for (addr = vma.end; addr > (sp & -pagesize) + pagesize; )
+    {
+      uintptr_t count = (addr - ((sp & -pagesize) + pagesize)) / pagesize;
+      uintptr_t i;
+
+      if (count > MINCORE_BATCH)
+        count = MINCORE_BATCH;
+      addr -= count * pagesize;
+      if (mincore ((MINCORE_ADDR_T) addr, count * pagesize, vec) < 0)
+        return 0;
+      for (i = count; i > 0; i--)
+        if (vec[i - 1] & 1)
+          return addr + i * pagesize - vma.start;
+    }
+  return (sp & -pagesize) + pagesize - vma.start;
+# endif
+#else
+  return 0;
+#endif
+}
+
+/* Gives the pages of the stack whose VMA contains INSIDE back to the
+   system, from KEEP pages beyond the page of SP up to LIMIT or the end of
+   the VMA.  LIMIT is 0 if the stack ends with its VMA.  Returns 0 or -1.  */
+static int
+trim (uintptr_t inside, uintptr_t sp, uintptr_t keep, uintptr_t limit)
+{
+#if HAVE_STACKVMA && HAVE_MADVISE && defined MADV_DONTNEED
+  struct vma_struct vma;
+
+  if (pagesize == 0)
+    init_pagesize ();
+  if (sigsegv_get_vma (inside, &vma) < 0)
+    return -1;
+  /* The pages are given back to the system.  They read as zeroes when they
+     are touched again.  */
+# if STACK_DIRECTION < 0
+  {
+    uintptr_t start = (limit > vma.start ? (limit + pagesize - 1) & -pagesize
+                       : vma.start);
+    uintptr_t end = (sp & -pagesize) - keep * pagesize;
+
+    if (end > start && end <= sp
+        && madvise ((void *) start, end - start, MADV_DONTNEED) < 0)
+      return -1;
+  }
+# else
+  {
+    uintptr_t start = (sp & -pagesize) + (keep + 1) * pagesize;
+    uintptr_t end = (limit != 0 && limit < vma.end ? limit & -pagesize
+                     : vma.end);
+
+    if (start < end && start > sp
+        && madvise ((void *) start, end - start, MADV_DONTNEED) < 0)
+      return -1;
+  }
+# endif
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+size_t
+sigsegv_stack_high_water (void)
+{
+  volatile char dummy;
+  uintptr_t sp = (uintptr_t) &dummy;
+
+  return high_water (sp, sp);
+}
+
+int
+sigsegv_stack_trim (void)
+{
+  volatile char dummy;
+  uintptr_t sp = (uintptr_t) &dummy;
+
+  return trim (sp, sp, TRIM_KEEP_PAGES, 0);
+}
+
+/* An address in the stack that starts at BASE.  */
+#if STACK_DIRECTION < 0
+# define inside_stack(base) ((base) - 1)
+#else
+# define inside_stack(base) (base)
+#endif
+
+struct high_water_locals
+{
+  size_t *marks;
+  unsigned int max;
+};
+
+static void
+high_water_callback (void *arg, unsigned int index,
+                     uintptr_t base, uintptr_t limit, uintptr_t trim_bound)
+{
+  struct high_water_locals *locals = (struct high_water_locals *) arg;
+
+  if (index < locals->max)
+    locals->marks[index] =
+      high_water (inside_stack (base),
+                  trim_bound != 0 ? trim_bound : inside_stack (base));
+}
+
+unsigned int
+sigsegv_thread_stack_high_water (size_t *marks, unsigned int max)
+{
+  struct high_water_locals locals;
+
+  locals.marks = marks;
+  locals.max = max;
+  return sigsegv_thread_for_each_stack (high_water_callback, &locals);
+}
+
+struct trim_locals
+{
+  int trimmed;
+};
+
+static void
+trim_callback (void *arg, unsigned int index,
+               uintptr_t base, uintptr_t limit, uintptr_t trim_bound)
+{
+  struct trim_locals *locals = (struct trim_locals *) arg;
+
+  /* Only a parked thread with a known stack pointer can be trimmed.  */
+  if (trim_bound != 0 && locals->trimmed >= 0)
+    {
+      if (trim (inside_stack (base), trim_bound, 0, limit) < 0)
+        locals->trimmed = -1;
+      else
+        locals->trimmed++;
+    }
+}
+
+int
+sigsegv_thread_stack_trim (void)
+{
+#if HAVE_STACKVMA && HAVE_MADVISE && defined MADV_DONTNEED
+  struct trim_locals locals;
+
+  locals.trimmed = 0;
+  sigsegv_thread_for_each_stack (trim_callback, &locals);
+  return locals.trimmed;
+#else
+  return -1;
+#endif
+}
+
+#endif
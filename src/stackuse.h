@@ -0,0 +1,27 @@
+/* Measuring and trimming the stack usage of a thread.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _STACKUSE_H
+#define _STACKUSE_H
+
+#include <stdint.h>
+
+/* Sets the limit of the calling thread's own stack, for
+   sigsegv_stack_remaining, to LIMIT, or to none if LIMIT is 0.  Makes it
+   the current limit.  */
+extern void sigsegv_set_thread_stack_limit (uintptr_t limit);
+
+#endif /* _STACKUSE_H */
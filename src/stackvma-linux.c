@@ -14,12 +14,44 @@
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
+#include "sigsegv.h"
 #include "stackvma.h"
+#include "vmasnap.h"
 #include <stdio.h>
 
 #if defined __linux__ || defined __ANDROID__
+# include <string.h> /* memset */
 # include <sys/ioctl.h> /* ioctl */
 # include <linux/fs.h> /* PROCMAP_QUERY, struct procmap_query */
+# if !defined PROCMAP_QUERY && defined _IOWR
+/* The kernel headers are older than Linux 6.11.  The running kernel may
+   support the ioctl nevertheless; if it doesn't, the ioctl fails with ENOTTY.
+   This is the ABI of <linux/fs.h>.  */
+struct procmap_query
+{
+  uint64_t size;
+  uint64_t query_flags;
+  uint64_t query_addr;
+  uint64_t vma_start;
+  uint64_t vma_end;
+  uint64_t vma_flags;
+  uint64_t vma_page_size;
+  uint64_t vma_offset;
+  uint64_t inode;
+  uint32_t dev_major;
+  uint32_t dev_minor;
+  uint32_t vma_name_size;
+  uint32_t build_id_size;
+  uint64_t vma_name_addr;
+  uint64_t build_id_addr;
+};
+#  define PROCMAP_QUERY_VMA_READABLE 0x01
+#  define PROCMAP_QUERY_VMA_WRITABLE 0x02
+#  define PROCMAP_QUERY_VMA_EXECUTABLE 0x04
+#  define PROCMAP_QUERY_VMA_SHARED 0x08
+#  define PROCMAP_QUERY_COVERING_OR_NEXT_VMA 0x10
+#  define PROCMAP_QUERY _IOWR ('f', 17, struct procmap_query)
+# endif
 #endif
 
 #include "stackvma-simple.c"
@@ -75,8 +107,132 @@ callback (struct callback_locals *locals, uintptr_t start, uintptr_t end)
 
 #include "stackvma-vma-iter.c"
 
-int
-sigsegv_get_vma (uintptr_t address, struct vma_struct *vma)
+#if defined PROCMAP_QUERY /* Linux >= 6.11 */
+
+/* Stores the first VMA that ends after ADDR in *PQ.
+   Returns 0, or -1 with errno set.  */
+static int
+query_vma (int fd, uintptr_t addr, struct procmap_query *pq)
+{
+  /* Clear all fields, just in case some 'in' fields are added later.  */
+  memset (pq, 0, sizeof (*pq));
+  pq->size = sizeof (*pq);
+  pq->query_flags = PROCMAP_QUERY_COVERING_OR_NEXT_VMA;
+  pq->query_addr = addr;
+  return ioctl (fd, PROCMAP_QUERY, pq);
+}
+
+/* Determines the VMA that contains ADDRESS, and the neighbouring gap, with
+   a few PROCMAP_QUERY calls.  Unlike vma_iterate_procmap_query, it does not
+   walk the VMAs from address 0, so that its cost does not depend on the
+   number of VMAs.  Returns 0 if found, 1 if ADDRESS is not in a VMA, or -1
+   if the kernel does not support PROCMAP_QUERY.  */
+static int
+procmap_query_get_vma (uintptr_t address, struct vma_struct *vma)
+{
+  struct procmap_query pq;
+  int fd;
+  int ret;
+
+  fd = open ("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  if (query_vma (fd, address, &pq) < 0)
+    {
+      ret = (errno == ENOENT ? 1 : -1);
+      goto done;
+    }
+  if (pq.vma_start > address)
+    {
+      ret = 1;
+      goto done;
+    }
+  vma->start = pq.vma_start;
+  vma->end = pq.vma_end;
+# if STACK_DIRECTION < 0
+  /* There is no query for the previous VMA.  But a query at an address Q
+     below the start that returns this VMA shows that the previous VMA ends
+     at or below Q, and a query that returns another VMA shows that the
+     previous VMA ends at or above the end of that one.  Probe downwards at
+     distances that grow by a factor of 16, then bisect.  The number of
+     probes is bounded by the number of address bits, and is usually much
+     smaller.  */
+  {
+    uintptr_t pagesize = getpagesize ();
+    uintptr_t lo = 0;           /* prev_end >= lo */
+    uintptr_t hi = vma->start;  /* prev_end <= hi */
+    uintptr_t dist = pagesize;
+
+    while (hi > 0)
+      {
+        uintptr_t q = (vma->start > dist ? vma->start - dist : 0);
+
+        if (query_vma (fd, q, &pq) < 0)
+          {
+            ret = -1;
+            goto done;
+          }
+        if (pq.vma_start != vma->start)
+          {
+            lo = pq.vma_end;
+            break;
+          }
+        hi = q;
+        dist = (dist <= (uintptr_t) -1 / 16 ? 16 * dist : (uintptr_t) -1);
+      }
+    /* Most often, the VMA just found is the previous one.  */
+    if (lo < hi)
+      {
+        if (query_vma (fd, lo, &pq) < 0)
+          {
+            ret = -1;
+            goto done;
+          }
+        if (pq.vma_start == vma->start)
+          hi = lo;
+        else
+          lo = pq.vma_end;
+      }
+    /* The ends of VMAs are page-aligned, and so are LO and HI.  */
+    while (lo < hi)
+      {
+        uintptr_t mid = lo + (((hi - lo) / 2) & -pagesize);
+
+        if (query_vma (fd, mid, &pq) < 0)
+          {
+            ret = -1;
+            goto done;
+          }
+        if (pq.vma_start == vma->start)
+          hi = mid;
+        else
+          lo = pq.vma_end;
+      }
+    vma->prev_end = lo;
+  }
+# else
+  /* The next VMA is the one that the next query returns.  */
+  vma->next_start = (query_vma (fd, vma->end, &pq) == 0 ? pq.vma_start : 0);
+# endif
+  ret = 0;
+
+ done:
+  close (fd);
+  return ret;
+}
+
+#else
+
+# define procmap_query_get_vma(address, vma) (errno = ENOTTY, -1)
+
+#endif
+
+/* Determines the VMA that contains ADDRESS by iterating over the VMAs.
+   Returns 0 if found, 1 if ADDRESS is not in a VMA, or -1 if the VMAs
+   cannot be enumerated.  */
+static int
+iterate_get_vma (int (*iterate) (struct callback_locals *),
+                 uintptr_t address, struct vma_struct *vma)
 {
   struct callback_locals locals;
   locals.address = address;
@@ -88,20 +244,423 @@ sigsegv_get_vma (uintptr_t address, struct vma_struct *vma)
 #endif
   locals.retval = -1;
 
-  vma_iterate (&locals);
-  if (locals.retval == 0)
-    {
+  if (iterate (&locals) < 0)
+    return -1;
+  if (locals.retval < 0)
+    return 1;
 #if !(STACK_DIRECTION < 0)
-      if (locals.stop_at_next_vma)
-        vma->next_start = 0;
+  if (locals.stop_at_next_vma)
+    vma->next_start = 0;
+#endif
+  return 0;
+}
+
+int
+sigsegv_get_vma_with (int backend, uintptr_t address, struct vma_struct *vma)
+{
+  int ret;
+
+  switch (backend)
+    {
+    case SV_VMA_BACKEND_AUTO:
+      return (sigsegv_get_vma (address, vma) == 0 ? 0 : 1);
+    case SV_VMA_BACKEND_PROCMAP_QUERY:
+      ret = procmap_query_get_vma (address, vma);
+      break;
+    case SV_VMA_BACKEND_PROC:
+      ret = iterate_get_vma (vma_iterate_proc, address, vma);
+      break;
+    case SV_VMA_BACKEND_ITERATE:
+      ret = iterate_get_vma (vma_iterate, address, vma);
+      break;
+#if HAVE_MINCORE
+    case SV_VMA_BACKEND_MINCORE:
+      return (mincore_get_vma (address, vma) == 0 ? 0 : 1);
 #endif
-      vma->is_near_this = simple_is_near_this;
+    default:
+      return -1;
+    }
+  if (ret == 0)
+    vma->is_near_this = simple_is_near_this;
+  return ret;
+}
+
+/* The backend that sigsegv_get_vma uses, once it has been chosen.  */
+static volatile unsigned int vma_backend = SV_VMA_BACKEND_AUTO;
+
+/* Returns nonzero if BACKEND, which failed with error ERR, will never work
+   in this process: the kernel does not support PROCMAP_QUERY, or /proc is
+   not mounted.  Other failures, such as EMFILE or ENOMEM, may be
+   temporary.  */
+static int
+backend_unavailable (unsigned int backend, int err)
+{
+  switch (backend)
+    {
+    case SV_VMA_BACKEND_PROCMAP_QUERY:
+      return err == ENOTTY || err == EINVAL || err == ENOENT;
+    case SV_VMA_BACKEND_PROC:
+      return err == ENOENT;
+    default:
       return 0;
     }
+}
 
-#if HAVE_MINCORE
-  return mincore_get_vma (address, vma);
+/* Chooses the backend for sigsegv_get_vma: the first one that works among
+   those that give exact results, or else mincore().  PROCMAP_QUERY comes
+   first, because its cost does not grow with the number of VMAs.  Parsing
+   /proc/self/maps can be faster in a process with few VMAs, such as at the
+   time of the first call; therefore the choice is not based on timing.
+   The choice is recorded only if the backends before it are unavailable for
+   good; after a temporary failure, the next call chooses again.
+   Determines the VMA that contains ADDRESS on the way, like
+   sigsegv_get_vma_with, and stores the backend that answered in
+   *BACKENDP.  */
+static int
+choose_backend (uintptr_t address, struct vma_struct *vma,
+                unsigned int *backendp)
+{
+  static const unsigned int candidates[] =
+    {
+      SV_VMA_BACKEND_PROCMAP_QUERY,
+      SV_VMA_BACKEND_PROC,
+      SV_VMA_BACKEND_MINCORE
+    };
+  unsigned int i;
+  int definitive = 1;
+
+  for (i = 0; i < sizeof (candidates) / sizeof (candidates[0]); i++)
+    {
+      int ret;
+
+      errno = 0;
+      ret = sigsegv_get_vma_with (candidates[i], address, vma);
+      if (ret >= 0 || i == sizeof (candidates) / sizeof (candidates[0]) - 1)
+        {
+          *backendp = candidates[i];
+          if (definitive)
+            sv_atomic_store (&vma_backend, candidates[i]);
+          return ret;
+        }
+      if (!backend_unavailable (candidates[i], errno))
+        definitive = 0;
+    }
+  return -1;
+}
+
+int
+sigsegv_get_vma (uintptr_t address, struct vma_struct *vma)
+{
+  unsigned int backend = sv_atomic_load (&vma_backend);
+  int ret;
+
+  /* Search the snapshot first, if it is enabled.  */
+  {
+    struct vma_snapshot_entry entry;
+    uintptr_t prev_end;
+    uintptr_t next_start;
+
+    ret = sigsegv_vma_snapshot_lookup (address, &entry, &prev_end, &next_start);
+    if (ret == 0)
+      {
+        vma->start = entry.start;
+        vma->end = entry.end;
+#if STACK_DIRECTION < 0
+        vma->prev_end = prev_end;
 #else
+        vma->next_start = next_start;
+#endif
+        vma->is_near_this = simple_is_near_this;
+        return 0;
+      }
+  }
+
+  if (ret > 0)
+    /* ADDRESS is not mapped, according to a fresh snapshot.  */
+    ;
+  else if (backend == SV_VMA_BACKEND_AUTO)
+    ret = choose_backend (address, vma, &backend);
+  else
+    {
+      ret = sigsegv_get_vma_with (backend, address, vma);
+      /* The chosen backend may fail temporarily, for example when no file
+         descriptor is available.  */
+      if (ret < 0 && backend == SV_VMA_BACKEND_PROCMAP_QUERY)
+        ret = sigsegv_get_vma_with (SV_VMA_BACKEND_PROC, address, vma);
+    }
+  if (ret == 0)
+    return 0;
+
+  /* The address is not in a VMA, or the VMAs cannot be determined.  mincore()
+     may still find a mapped range.  */
+#if HAVE_MINCORE
+  if (backend != SV_VMA_BACKEND_MINCORE)
+    return (mincore_get_vma (address, vma) == 0 ? 0 : -1);
+#endif
   return -1;
+}
+
+
+/* Iteration over the VMAs with their protections and names, for
+   sigsegv_vma_iterate and sigsegv_vma_query.  */
+
+/* Passes the VMAs that end after FROM to CALLBACK, in ascending order, by
+   parsing /proc/self/maps.  Returns 0, or -1 if the file cannot be read.  */
+static int
+proc_vma_iterate (uintptr_t from,
+                  sigsegv_vma_callback_t callback, void *user_arg,
+                  char *name_buf, size_t name_size)
+{
+  struct rofile rof;
+  uintptr_t auxmap_start;
+  uintptr_t auxmap_end;
+
+  if (rof_open (&rof, "/proc/self/maps") < 0)
+    return -1;
+  auxmap_start = rof.auxmap_start;
+  auxmap_end = rof.auxmap_end;
+  for (;;)
+    {
+      /* Parse one line.  First start and end.  */
+      uintptr_t start, end;
+      uintptr_t pieces[2][2];
+      unsigned int n, i;
+      sigsegv_vma vma;
+
+      if (!(rof_scanf_lx (&rof, &start) >= 0
+            && rof_getchar (&rof) == '-'
+            && rof_scanf_lx (&rof, &end) >= 0
+            && rof_getchar (&rof) == ' '))
+        break;
+      if (end - 1 < from)
+        {
+          rof_skip_line (&rof);
+          continue;
+        }
+
+      /* Then the protection, such as "rw-p".  */
+      vma.prot = 0;
+      if (rof_getchar (&rof) == 'r')
+        vma.prot |= SIGSEGV_VMA_READ;
+      if (rof_getchar (&rof) == 'w')
+        vma.prot |= SIGSEGV_VMA_WRITE;
+      if (rof_getchar (&rof) == 'x')
+        vma.prot |= SIGSEGV_VMA_EXECUTE;
+      if (rof_getchar (&rof) == 's')
+        vma.prot |= SIGSEGV_VMA_SHARED;
+
+      /* Then the offset, device, and inode, and the name.  */
+      vma.name = NULL;
+      if (name_buf != NULL)
+        {
+          int c;
+
+          for (i = 0; i < 3; i++)
+            {
+              while (rof_peekchar (&rof) == ' ')
+                rof_getchar (&rof);
+              while (c = rof_peekchar (&rof), c != ' ' && c != '\n' && c != -1)
+                rof_getchar (&rof);
+            }
+          while (rof_peekchar (&rof) == ' ')
+            rof_getchar (&rof);
+          rof_copy_line (&rof, name_buf, name_size);
+          vma.name = name_buf;
+        }
+      else
+        rof_skip_line (&rof);
+
+      /* Leave out the memory that holds the file contents.  */
+      n = 0;
+      if (start <= auxmap_start && auxmap_end - 1 <= end - 1)
+        {
+          if (start < auxmap_start)
+            {
+              pieces[n][0] = start;
+              pieces[n][1] = auxmap_start;
+              n++;
+            }
+          if (auxmap_end - 1 < end - 1)
+            {
+              pieces[n][0] = auxmap_end;
+              pieces[n][1] = end;
+              n++;
+            }
+        }
+      else
+        {
+          pieces[n][0] = start;
+          pieces[n][1] = end;
+          n++;
+        }
+      for (i = 0; i < n; i++)
+        if (!(pieces[i][1] - 1 < from))
+          {
+            vma.start = (void *) pieces[i][0];
+            vma.end = (void *) pieces[i][1];
+            if (callback (user_arg, &vma))
+              goto done;
+          }
+    }
+ done:
+  rof_close (&rof);
+  return 0;
+}
+
+#if defined PROCMAP_QUERY /* Linux >= 6.11 */
+
+/* Passes the VMAs that end after FROM to CALLBACK, in ascending order, with
+   PROCMAP_QUERY calls.  Returns 0, or -1 if the kernel does not support
+   PROCMAP_QUERY or if the VMAs cannot be enumerated completely.  */
+static int
+procmap_query_vma_iterate (uintptr_t from,
+                           sigsegv_vma_callback_t callback, void *user_arg,
+                           char *name_buf, size_t name_size)
+{
+  uintptr_t addr = from;
+  int fd;
+
+  fd = open ("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  if (name_size > 0xFFFFFFFFU)
+    name_size = 0xFFFFFFFFU;
+  for (;;)
+    {
+      struct procmap_query pq;
+      sigsegv_vma vma;
+
+      /* Clear all fields, just in case some 'in' fields are added later.  */
+      memset (&pq, 0, sizeof (pq));
+      pq.size = sizeof (pq);
+      pq.query_flags = PROCMAP_QUERY_COVERING_OR_NEXT_VMA;
+      pq.query_addr = addr;
+      if (name_buf != NULL)
+        {
+          pq.vma_name_addr = (uintptr_t) name_buf;
+          pq.vma_name_size = name_size;
+        }
+      if (ioctl (fd, PROCMAP_QUERY, &pq) < 0)
+        {
+          int saved_errno = errno;
+
+          close (fd);
+          if (saved_errno == ENOENT)
+            /* No more VMAs.  */
+            return 0;
+          if (addr == from && saved_errno != ENAMETOOLONG)
+            /* Likely errno == ENOTTY.  The caller tries another way.  */
+            return -1;
+          /* The kernel does not truncate names (ENAMETOOLONG), or the query
+             failed partway through (e.g. EINTR, ENOMEM).  Continue from the
+             file, so that the caller does not get a truncated list.  */
+          return (proc_vma_iterate (addr, callback, user_arg,
+                                    name_buf, name_size) < 0 ? -1 : 0);
+        }
+
+      vma.start = (void *) (uintptr_t) pq.vma_start;
+      vma.end = (void *) (uintptr_t) pq.vma_end;
+      vma.prot = 0;
+      if (pq.vma_flags & PROCMAP_QUERY_VMA_READABLE)
+        vma.prot |= SIGSEGV_VMA_READ;
+      if (pq.vma_flags & PROCMAP_QUERY_VMA_WRITABLE)
+        vma.prot |= SIGSEGV_VMA_WRITE;
+      if (pq.vma_flags & PROCMAP_QUERY_VMA_EXECUTABLE)
+        vma.prot |= SIGSEGV_VMA_EXECUTE;
+      if (pq.vma_flags & PROCMAP_QUERY_VMA_SHARED)
+        vma.prot |= SIGSEGV_VMA_SHARED;
+      vma.name = NULL;
+      if (name_buf != NULL)
+        {
+          /* The kernel stores no name for an anonymous VMA.  */
+          if (pq.vma_name_size == 0)
+            name_buf[0] = '\0';
+          vma.name = name_buf;
+        }
+      if (callback (user_arg, &vma))
+        break;
+
+      addr = pq.vma_end;
+      if (addr == 0)
+        break;
+    }
+  close (fd);
+  return 0;
+}
+
+#else
+
+# define procmap_query_vma_iterate(from, callback, user_arg, name_buf, name_size) (-1)
+
 #endif
+
+/* Passes the VMAs that end after FROM to CALLBACK, with the fastest way
+   that works.  Returns 0, or -1 if the VMAs cannot be enumerated.  */
+static int
+vma_iterate_from (uintptr_t from,
+                  sigsegv_vma_callback_t callback, void *user_arg,
+                  char *name_buf, size_t name_size)
+{
+  if (name_size == 0)
+    name_buf = NULL;
+  /* Don't try PROCMAP_QUERY again if sigsegv_get_vma found it missing.  */
+  if (sv_atomic_load (&vma_backend) != SV_VMA_BACKEND_PROC
+      && procmap_query_vma_iterate (from, callback, user_arg,
+                                   name_buf, name_size) == 0)
+    return 0;
+  return proc_vma_iterate (from, callback, user_arg, name_buf, name_size);
+}
+
+int
+sigsegv_vma_iterate (sigsegv_vma_callback_t callback, void *user_arg,
+                     char *name_buf, size_t name_size)
+{
+  return vma_iterate_from (0, callback, user_arg, name_buf, name_size);
+}
+
+/* A callback for sigsegv_vma_query: stores the first VMA.  */
+static int
+store_first_vma (void *user_arg, const sigsegv_vma *vma)
+{
+  sigsegv_vma **resultp = (sigsegv_vma **) user_arg;
+
+  **resultp = *vma;
+  *resultp = NULL;
+  return 1;
+}
+
+int
+sigsegv_vma_query (void *address, sigsegv_vma *vma,
+                   char *name_buf, size_t name_size)
+{
+  sigsegv_vma *result = vma;
+
+  /* The snapshot has no names.  */
+  if (name_buf == NULL || name_size == 0)
+    {
+      struct vma_snapshot_entry entry;
+      uintptr_t prev_end;
+      uintptr_t next_start;
+      int ret = sigsegv_vma_snapshot_lookup ((uintptr_t) address, &entry,
+                                             &prev_end, &next_start);
+      if (ret >= 0)
+        {
+          if (ret == 0)
+            {
+              vma->start = (void *) entry.start;
+              vma->end = (void *) entry.end;
+              vma->prot = entry.prot;
+              vma->name = NULL;
+            }
+          return ret;
+        }
+    }
+
+  if (vma_iterate_from ((uintptr_t) address, store_first_vma, &result,
+                        name_buf, name_size) < 0)
+    return -1;
+  /* The first VMA that ends after ADDRESS may start after it.  */
+  if (result != NULL || (uintptr_t) vma->start > (uintptr_t) address)
+    return 1;
+  return 0;
 }
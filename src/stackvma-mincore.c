@@ -85,17 +85,42 @@ is_mapped (uintptr_t addr)
   return mincore ((MINCORE_ADDR_T) addr, pagesize, vec) >= 0;
 }
 
+/* The number of pages that one mincore() call inquires at most.  */
+#define MAX_STEP 1024
+
+/* Test whether the pages in the range [ADDR1, ADDR2) are all mapped.
+   ADDR1 and ADDR2 must be multiples of pagesize.  */
+static int
+is_mapped_range (uintptr_t addr1, uintptr_t addr2)
+{
+  /* Use a moderately sized VEC here, small enough that it fits on the stack
+     (without requiring malloc).  */
+  pageinfo_t vec[MAX_STEP];
+
+  while (addr1 < addr2)
+    {
+      uintptr_t stepsize = (addr2 - addr1) / pagesize;
+
+      if (stepsize > MAX_STEP)
+        stepsize = MAX_STEP;
+      if (mincore ((MINCORE_ADDR_T) addr1, stepsize * pagesize, vec) < 0)
+        return 0;
+      addr1 += stepsize * pagesize;
+    }
+  return 1;
+}
+
 /* Assuming that the page starting at ADDR is among the address range,
    return the start of its virtual memory range.
    ADDR must be a multiple of pagesize.  */
 static uintptr_t
 mapped_range_start (uintptr_t addr)
 {
-  /* Use a moderately sized VEC here, small enough that it fits on the stack
-     (without requiring malloc).  */
-  pageinfo_t vec[1024];
-  uintptr_t stepsize = sizeof (vec);
+  pageinfo_t vec[MAX_STEP];
+  uintptr_t stepsize = 1;
 
+  /* Search in steps that double, so that the number of mincore() calls
+     grows only logarithmically with the size of a small range.  */
   for (;;)
     {
       uintptr_t max_remaining;
@@ -110,9 +135,12 @@ mapped_range_start (uintptr_t addr)
                    stepsize * pagesize, vec) < 0)
         /* Time to search in smaller steps.  */
         break;
-      /* The entire range exists.  Continue searching in large steps.  */
+      /* The entire range exists.  Continue searching in larger steps.  */
       addr -= stepsize * pagesize;
+      if (stepsize < MAX_STEP)
+        stepsize = 2 * stepsize;
     }
+  /* Then bisect.  */
   for (;;)
     {
       if (stepsize == 1)
@@ -140,11 +168,10 @@ mapped_range_start (uintptr_t addr)
 static uintptr_t
 mapped_range_end (uintptr_t addr)
 {
-  /* Use a moderately sized VEC here, small enough that it fits on the stack
-     (without requiring malloc).  */
-  pageinfo_t vec[1024];
-  uintptr_t stepsize = sizeof (vec);
+  pageinfo_t vec[MAX_STEP];
+  uintptr_t stepsize = 1;
 
+  /* Search in steps that double, like in mapped_range_start.  */
   addr += pagesize;
   for (;;)
     {
@@ -157,9 +184,12 @@ mapped_range_end (uintptr_t addr)
       if (mincore ((MINCORE_ADDR_T) addr, stepsize * pagesize, vec) < 0)
         /* Time to search in smaller steps.  */
         break;
-      /* The entire range exists.  Continue searching in large steps.  */
+      /* The entire range exists.  Continue searching in larger steps.  */
       addr += stepsize * pagesize;
+      if (stepsize < MAX_STEP)
+        stepsize = 2 * stepsize;
     }
+  /* Then bisect.  */
   for (;;)
     {
       if (stepsize == 1)
@@ -180,6 +210,22 @@ mapped_range_end (uintptr_t addr)
     }
 }
 
+/* The boundaries found by the previous searches of the calling thread.
+   Typically, the calling thread asks for the same stack over and over again.
+   The memory map may have changed in between; therefore every cached value
+   is verified before it is used.  */
+static SV_THREAD_LOCAL struct
+{
+  /* A mapped range [start, end), or start == end if unknown.  A range
+     that extends to the end of the address space is not cached.  */
+  uintptr_t start;
+  uintptr_t end;
+  /* A mapped page that lies in a gap that is_unmapped was asked about,
+     or 0 if none.  */
+  uintptr_t witness;
+}
+boundary_cache;
+
 /* Determine whether an address range [ADDR1..ADDR2] is completely unmapped.
    ADDR1 must be <= ADDR2.  */
 static int
@@ -201,6 +247,11 @@ is_unmapped (uintptr_t addr1, uintptr_t addr2)
      traverse only every second, or only fourth page, etc.  This doesn't
      decrease the worst-case runtime, only the average runtime.  */
   uintptr_t count = (addr2 - addr1) / pagesize;
+  /* A range that contained a mapped page likely still does.  This makes
+     repeated inquiries about the same gap cheap.  */
+  uintptr_t witness = boundary_cache.witness;
+  if (witness >= addr1 && witness < addr2 && is_mapped (witness))
+    return 0;
   /* We have to test is_mapped (addr1 + i * pagesize) for 0 <= i < count.  */
   uintptr_t stepsize;
   for (stepsize = 1; stepsize < count; )
@@ -218,7 +269,10 @@ is_unmapped (uintptr_t addr1, uintptr_t addr2)
            i += 2 * stepsize, addr += 2 * addr_stepsize)
         /* Here addr = addr1 + i * pagesize.  */
         if (is_mapped (addr))
-          return 0;
+          {
+            boundary_cache.witness = addr;
+            return 0;
+          }
     }
   return 1;
 }
@@ -276,8 +330,29 @@ mincore_get_vma (uintptr_t address, struct vma_struct *vma)
   if (pagesize == 0)
     init_pagesize ();
   address = (address / pagesize) * pagesize;
-  vma->start = mapped_range_start (address);
-  vma->end = mapped_range_end (address);
+  {
+    uintptr_t start = boundary_cache.start;
+    uintptr_t end = boundary_cache.end;
+
+    /* Verify the cached range: all of it must still be mapped, and the pages
+       next to it unmapped.  This takes fewer mincore() calls than a search,
+       unless the range is huge.  */
+    if (address >= start && address < end
+        && (start == 0 || !is_mapped (start - pagesize))
+        && !is_mapped (end)
+        && is_mapped_range (start, end))
+      {
+        vma->start = start;
+        vma->end = end;
+      }
+    else
+      {
+        vma->start = mapped_range_start (address);
+        vma->end = mapped_range_end (address);
+        boundary_cache.start = vma->start;
+        boundary_cache.end = vma->end;
+      }
+  }
   vma->is_near_this = mincore_is_near_this;
   return 0;
 }
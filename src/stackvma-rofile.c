@@ -17,6 +17,7 @@
 #include <errno.h> /* errno, EINTR */
 #include <fcntl.h> /* O_RDONLY */
 #include <stddef.h> /* size_t */
+#include <string.h> /* memchr */
 #include <unistd.h> /* getpagesize, lseek, read, close */
 #include <sys/types.h>
 #include <sys/mman.h> /* mmap, munmap */
@@ -25,6 +26,8 @@
 # include <limits.h> /* PATH_MAX */
 #endif
 
+#include "atomic.h"
+
 /* DragonFly BSD 3.8 still has only MAP_ANON and not MAP_ANONYMOUS.  */
 #if HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS
 # define MAP_ANONYMOUS MAP_ANON
@@ -75,11 +78,42 @@ struct rofile
     char *buffer;
     char *auxmap;
     size_t auxmap_length;
+    /* The VMA of auxmap, if rof_close unmaps it, so that the parsers ignore
+       it.  Otherwise 0 and 0: the scratch buffer stays mapped and is
+       reported like any other VMA.  */
     uintptr_t auxmap_start;
     uintptr_t auxmap_end;
+    /* Nonzero if auxmap is, or will become, the scratch buffer.  */
+    int scratch;
     char stack_allocated_buffer[STACK_ALLOCATED_BUFFER_SIZE];
   };
 
+/* A buffer that is kept from one rof_open call to the next, so that a file
+   that did not fit into the stack-allocated buffer is read only once, with
+   a buffer of the size that was sufficient the previous time.  It belongs to
+   one read-only file stream at a time.  When it is busy, for example in
+   another thread or in a signal handler that interrupted rof_open, a stream
+   allocates a buffer of its own.  Since the scratch buffer outlives the
+   stream, it is not ignored like the VMA of such a buffer.  */
+static char *rof_scratch;
+static size_t rof_scratch_length;
+static volatile unsigned int rof_scratch_busy;
+
+/* Free the buffer of a read-only file stream, or give it back as the
+   scratch buffer.  */
+static void
+rof_release (struct rofile *rof)
+{
+  if (rof->scratch)
+    {
+      rof_scratch = rof->auxmap;
+      rof_scratch_length = (rof->auxmap != NULL ? rof->auxmap_length : 0);
+      sv_atomic_store (&rof_scratch_busy, 0);
+    }
+  else if (rof->auxmap != NULL)
+    munmap (rof->auxmap, rof->auxmap_length);
+}
+
 /* Open a read-only file stream.  */
 static int
 rof_open (struct rofile *rof, const char *filename)
@@ -96,6 +130,16 @@ rof_open (struct rofile *rof, const char *filename)
   rof->auxmap = NULL;
   rof->auxmap_start = 0;
   rof->auxmap_end = 0;
+  rof->scratch = sv_atomic_compare_and_swap (&rof_scratch_busy, 0, 1);
+  if (rof->scratch && rof_scratch != NULL)
+    {
+      /* Start with the scratch buffer.  */
+      pagesize = getpagesize ();
+      rof->auxmap = rof_scratch;
+      rof->auxmap_length = rof_scratch_length;
+      rof->buffer = rof->auxmap;
+      size = rof->auxmap_length;
+    }
   for (;;)
     {
       /* Attempt to read the contents in a single system call.  */
@@ -166,11 +210,16 @@ rof_open (struct rofile *rof, const char *filename)
       if (rof->auxmap == (void *) -1)
         {
           close (fd);
+          rof->auxmap = NULL;
+          rof_release (rof);
           return -1;
         }
       rof->auxmap_length = size;
-      rof->auxmap_start = (uintptr_t) rof->auxmap;
-      rof->auxmap_end = rof->auxmap_start + size;
+      if (!rof->scratch)
+        {
+          rof->auxmap_start = (uintptr_t) rof->auxmap;
+          rof->auxmap_end = rof->auxmap_start + size;
+        }
       rof->buffer = (char *) rof->auxmap;
      retry:
       /* Restart.  */
@@ -185,8 +234,7 @@ rof_open (struct rofile *rof, const char *filename)
  fail1:
   close (fd);
  fail2:
-  if (rof->auxmap != NULL)
-    munmap (rof->auxmap, rof->auxmap_length);
+  rof_release (rof);
   return -1;
 }
 
@@ -217,32 +265,76 @@ rof_getchar (struct rofile *rof)
 static int
 rof_scanf_lx (struct rofile *rof, uintptr_t *valuep)
 {
+  /* Work on the buffer directly, not through rof_peekchar.  */
+  const char *start = rof->buffer + rof->position;
+  const char *end = rof->buffer + rof->filled;
+  const char *p;
   uintptr_t value = 0;
-  unsigned int numdigits = 0;
-  for (;;)
+  for (p = start; p < end; p++)
     {
-      int c = rof_peekchar (rof);
-      if (c >= '0' && c <= '9')
-        value = (value << 4) + (c - '0');
-      else if (c >= 'A' && c <= 'F')
-        value = (value << 4) + (c - 'A' + 10);
-      else if (c >= 'a' && c <= 'f')
-        value = (value << 4) + (c - 'a' + 10);
-      else
-        break;
-      rof_getchar (rof);
-      numdigits++;
+      unsigned int digit = (unsigned char) *p - '0';
+      if (digit > 9)
+        {
+          /* Map 'A'..'F' and 'a'..'f' to 10..15, anything else to > 15.  */
+          digit = ((unsigned char) *p | 0x20) - 'a';
+          if (digit > 5)
+            break;
+          digit += 10;
+        }
+      value = (value << 4) + digit;
     }
-  if (numdigits == 0)
+  if (p == end)
+    rof->eof_seen = 1;
+  if (p == start)
     return -1;
+  rof->position = p - rof->buffer;
   *valuep = value;
   return 0;
 }
 
+/* Skip the rest of the current line of a read-only file stream, including
+   the newline.  */
+static void
+rof_skip_line (struct rofile *rof)
+{
+  const char *nl = (const char *) memchr (rof->buffer + rof->position, '\n',
+                                          rof->filled - rof->position);
+  if (nl != NULL)
+    rof->position = nl + 1 - rof->buffer;
+  else
+    {
+      rof->position = rof->filled;
+      rof->eof_seen = 1;
+    }
+}
+
+#if defined __linux__ || defined __ANDROID__
+
+/* Copies the rest of the current line, without the newline, into
+   BUF[0..SIZE-1], truncated if needed, and skips the line.  */
+static void
+rof_copy_line (struct rofile *rof, char *buf, size_t size)
+{
+  const char *p = rof->buffer + rof->position;
+  size_t n = rof->filled - rof->position;
+  const char *nl = (const char *) memchr (p, '\n', n);
+
+  if (nl != NULL)
+    n = nl - p;
+  if (size > 0)
+    {
+      size_t k = (n < size - 1 ? n : size - 1);
+      memcpy (buf, p, k);
+      buf[k] = '\0';
+    }
+  rof_skip_line (rof);
+}
+
+#endif
+
 /* Close a read-only file stream.  */
 static void
 rof_close (struct rofile *rof)
 {
-  if (rof->auxmap != NULL)
-    munmap (rof->auxmap, rof->auxmap_length);
+  rof_release (rof);
 }
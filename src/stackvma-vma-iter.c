@@ -43,11 +43,7 @@ vma_iterate_proc (struct callback_locals *locals)
                 && rof_scanf_lx (&rof, &end) >= 0))
             break;
 
-          {
-            int c;
-            while (c = rof_getchar (&rof), c != -1 && c != '\n')
-              ;
-          }
+          rof_skip_line (&rof);
 
           if (start <= auxmap_start && auxmap_end - 1 <= end - 1)
             {
@@ -111,11 +107,7 @@ vma_iterate_proc (struct callback_locals *locals)
                 && rof_getchar (&rof) == 'x'
                 && rof_scanf_lx (&rof, &end) >= 0))
             break;
-          {
-            int c;
-            while (c = rof_getchar (&rof), c != -1 && c != '\n')
-              ;
-          }
+          rof_skip_line (&rof);
 
           if (start <= auxmap_start && auxmap_end - 1 <= end - 1)
             {
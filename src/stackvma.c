@@ -17,3 +17,25 @@
 #include "config.h"
 
 #include CFG_STACKVMA
+
+#if !(defined __linux__ || defined __ANDROID__) || !HAVE_STACKVMA
+
+#include "sigsegv.h"
+
+/* Only the Linux version implements these.  */
+
+int
+sigsegv_vma_iterate (sigsegv_vma_callback_t callback, void *user_arg,
+                     char *name_buf, size_t name_size)
+{
+  return -1;
+}
+
+int
+sigsegv_vma_query (void *address, sigsegv_vma *vma,
+                   char *name_buf, size_t name_size)
+{
+  return -1;
+}
+
+#endif
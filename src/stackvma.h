@@ -46,4 +46,30 @@ struct vma_struct
    This function is used to determine the stack extent when a fault occurs.  */
 extern int sigsegv_get_vma (uintptr_t address, struct vma_struct *vma);
 
+#if defined __linux__ || defined __ANDROID__
+
+/* The ways in which sigsegv_get_vma can determine a virtual memory area.  */
+enum
+{
+  /* The one chosen at the first call to sigsegv_get_vma.  */
+  SV_VMA_BACKEND_AUTO,
+  /* A few PROCMAP_QUERY calls around the address.  Linux >= 6.11.  */
+  SV_VMA_BACKEND_PROCMAP_QUERY,
+  /* Parsing /proc/self/maps.  */
+  SV_VMA_BACKEND_PROC,
+  /* Probing with mincore().  Gives approximate bounds only.  */
+  SV_VMA_BACKEND_MINCORE,
+  /* Iterating over all virtual memory areas from address 0, with
+     PROCMAP_QUERY or by parsing /proc/self/maps.  */
+  SV_VMA_BACKEND_ITERATE
+};
+
+/* Determines the virtual memory area to which ADDRESS belongs, with the
+   given backend.  Returns 0 if found, 1 if ADDRESS is not mapped, or -1 if
+   the backend is not supported.  For benchmarks.  */
+extern int sigsegv_get_vma_with (int backend, uintptr_t address,
+                                 struct vma_struct *vma);
+
+#endif
+
 #endif /* _STACKVMA_H */
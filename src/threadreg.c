@@ -0,0 +1,319 @@
+/* Registry of the threads whose stacks are known.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "threadreg.h"
+
+#include <stdlib.h>
+
+#include "atomic.h"
+
+/* Every thread that registers itself gets a struct registered_thread.  The
+   structs are linked in a list that only grows: the struct of a thread that
+   unregisters is marked free and reused by the next thread that registers.
+   Therefore the list can be traversed without locks, while other threads
+   register and unregister.  A thread updates its own struct only.  */
+
+struct registered_thread
+{
+  /* Link in the list of all structs.  */
+  struct registered_thread *next;
+  /* Nonzero while the struct belongs to a thread.  */
+  volatile unsigned int in_use;
+  /* The thread's own stack: where it starts, up to where it can grow, and
+     up to where it is known to be mapped.  */
+  uintptr_t own_base;
+  uintptr_t own_limit;
+  uintptr_t own_mapped;
+  /* The stack the thread currently runs on, likewise.  */
+  volatile uintptr_t base;
+  volatile uintptr_t limit;
+  volatile uintptr_t mapped;
+  /* The thread's alternate stack.  */
+  uintptr_t extra_stack;
+  size_t extra_stack_size;
+  /* Nonzero while the thread is parked at the safepoint.  Then the other
+     fields describe the part of the stack in use and the memory that holds
+     the saved registers.  */
+  volatile int parked;
+  uintptr_t start;
+  uintptr_t end;
+  uintptr_t regs_start;
+  uintptr_t regs_end;
+  /* While parked: the end of the part of the stack in use beyond which the
+     stack may be trimmed, or 0 if that is not known.  */
+  uintptr_t trim_bound;
+};
+
+/* The size of the area beyond the stack pointer that the ABI allows leaf
+   functions to use without moving the stack pointer.  */
+#if (defined __x86_64__ && !defined _WIN64) || (defined __aarch64__ && defined __APPLE__)
+# define RED_ZONE_SIZE 128
+#elif defined __powerpc64__
+# define RED_ZONE_SIZE 288
+#else
+# define RED_ZONE_SIZE 0
+#endif
+
+static struct registered_thread *volatile thread_list;
+
+/* The struct of the calling thread, or NULL.  */
+static SV_THREAD_LOCAL struct registered_thread *current_thread;
+
+int
+sigsegv_thread_add (uintptr_t base, uintptr_t limit, uintptr_t mapped,
+                    uintptr_t extra_stack, size_t extra_stack_size)
+{
+  struct registered_thread *t = current_thread;
+
+  if (t == NULL)
+    {
+      /* Reuse a free struct, or allocate a new one.  */
+      for (t = sv_atomic_load (&thread_list); t != NULL; t = t->next)
+        if (t->in_use == 0 && sv_atomic_compare_and_swap (&t->in_use, 0, 1))
+          break;
+      if (t == NULL)
+        {
+          struct registered_thread *head;
+
+          t = (struct registered_thread *)
+              malloc (sizeof (struct registered_thread));
+          if (t == NULL)
+            return -1;
+          t->in_use = 1;
+          do
+            {
+              head = sv_atomic_load (&thread_list);
+              t->next = head;
+            }
+          while (!sv_atomic_compare_and_swap (&thread_list, head, t));
+        }
+      t->parked = 0;
+      current_thread = t;
+    }
+  t->own_base = base;
+  t->own_limit = limit;
+  t->own_mapped = mapped;
+  t->base = base;
+  t->limit = limit;
+  t->mapped = mapped;
+  t->extra_stack = extra_stack;
+  t->extra_stack_size = extra_stack_size;
+  return 0;
+}
+
+void
+sigsegv_thread_remove (void)
+{
+  struct registered_thread *t = current_thread;
+
+  if (t != NULL)
+    {
+      current_thread = NULL;
+      t->parked = 0;
+      sv_atomic_store (&t->in_use, 0);
+    }
+}
+
+void
+sigsegv_thread_set_stack (uintptr_t base, uintptr_t limit, uintptr_t mapped)
+{
+  struct registered_thread *t = current_thread;
+
+  if (t != NULL)
+    {
+      if (base == 0)
+        {
+          base = t->own_base;
+          limit = t->own_limit;
+          mapped = t->own_mapped;
+        }
+      t->base = base;
+      t->limit = limit;
+      t->mapped = mapped;
+    }
+}
+
+void
+sigsegv_thread_set_mapped (uintptr_t mapped)
+{
+  struct registered_thread *t = current_thread;
+
+  if (t == NULL)
+    return;
+  /* A stack only grows.  The memory map may report a larger area than the
+     stack.  */
+#if STACK_DIRECTION > 0
+  if (!(mapped > t->base && mapped > t->mapped))
+    return;
+  if (mapped > t->limit)
+    mapped = t->limit;
+#else
+  if (!(mapped < t->base && mapped < t->mapped))
+    return;
+  if (mapped < t->limit)
+    mapped = t->limit;
+#endif
+  t->mapped = mapped;
+  if (t->base == t->own_base)
+    t->own_mapped = mapped;
+}
+
+void
+sigsegv_thread_park (uintptr_t sp)
+{
+  struct registered_thread *t = current_thread;
+  volatile char here;
+  uintptr_t frame = (uintptr_t) &here;
+
+  if (t == NULL)
+    return;
+  /* Without the stack pointer, the frame of the signal handler bounds the
+     part of the stack in use, if the handler runs on the stack.  */
+#if STACK_DIRECTION > 0
+  t->start = t->base;
+  t->end = (sp != 0 ? sp + RED_ZONE_SIZE + 1 : t->limit);
+  if (frame >= t->base && frame < t->end)
+    t->end = frame;
+#else
+  t->start = (sp != 0 ? sp - RED_ZONE_SIZE : t->limit);
+  t->end = t->base;
+  if (frame >= t->start && frame < t->end)
+    t->start = frame;
+#endif
+  /* The kernel saves the registers next to the frame of the signal handler.
+     If the handler runs on the alternate stack, that is where they are.  */
+  t->regs_start = 0;
+  t->regs_end = 0;
+  t->trim_bound = 0;
+  if (frame - t->extra_stack < t->extra_stack_size)
+    {
+#if STACK_DIRECTION > 0
+      t->regs_start = t->extra_stack;
+      t->regs_end = frame;
+#else
+      t->regs_start = frame;
+      t->regs_end = t->extra_stack + t->extra_stack_size;
+#endif
+      /* Nothing beyond the stack pointer is in use, since the handler runs
+         on the alternate stack.  */
+      if (sp != 0)
+#if STACK_DIRECTION > 0
+        t->trim_bound = t->end;
+#else
+        t->trim_bound = t->start;
+#endif
+    }
+  sv_atomic_store (&t->parked, 1);
+}
+
+void
+sigsegv_thread_unpark (void)
+{
+  struct registered_thread *t = current_thread;
+
+  if (t != NULL)
+    sv_atomic_store (&t->parked, 0);
+}
+
+unsigned int
+sigsegv_thread_stack_ranges (sigsegv_stack_range *ranges, unsigned int max)
+{
+  struct registered_thread *self = current_thread;
+  struct registered_thread *t;
+  unsigned int n = 0;
+
+  if (self != NULL)
+    {
+      volatile char here;
+
+      if (max > 0)
+        {
+#if STACK_DIRECTION > 0
+          ranges[0].start = (void *) self->base;
+          ranges[0].end = (void *) &here;
+#else
+          ranges[0].start = (void *) &here;
+          ranges[0].end = (void *) self->base;
+#endif
+          ranges[0].regs_start = NULL;
+          ranges[0].regs_end = NULL;
+          ranges[0].parked = 0;
+        }
+      n++;
+    }
+  for (t = sv_atomic_load (&thread_list); t != NULL; t = t->next)
+    if (t != self && sv_atomic_load (&t->in_use))
+      {
+        if (n < max)
+          {
+            sigsegv_stack_range *r = &ranges[n];
+
+            if (sv_atomic_load (&t->parked))
+              {
+                r->start = (void *) t->start;
+                r->end = (void *) t->end;
+                r->regs_start = (void *) t->regs_start;
+                r->regs_end = (void *) t->regs_end;
+                r->parked = 1;
+              }
+            else
+              {
+                /* The thread is running.  Its stack pointer is unknown.  */
+#if STACK_DIRECTION > 0
+                r->start = (void *) t->base;
+                r->end = (void *) t->mapped;
+#else
+                r->start = (void *) t->mapped;
+                r->end = (void *) t->base;
+#endif
+                r->regs_start = NULL;
+                r->regs_end = NULL;
+                r->parked = 0;
+              }
+          }
+        n++;
+      }
+  return n;
+}
+
+unsigned int
+sigsegv_thread_for_each_stack (sigsegv_thread_stack_callback_t callback,
+                               void *arg)
+{
+  struct registered_thread *self = current_thread;
+  struct registered_thread *t;
+  unsigned int n = 0;
+
+  /* The same order as in sigsegv_thread_stack_ranges.  */
+  if (self != NULL)
+    {
+      (*callback) (arg, n, self->base, self->limit, 0);
+      n++;
+    }
+  for (t = sv_atomic_load (&thread_list); t != NULL; t = t->next)
+    if (t != self && sv_atomic_load (&t->in_use))
+      {
+        uintptr_t trim_bound =
+          (sv_atomic_load (&t->parked) ? t->trim_bound : 0);
+
+        (*callback) (arg, n, t->base, t->limit, trim_bound);
+        n++;
+      }
+  return n;
+}
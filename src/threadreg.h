@@ -0,0 +1,66 @@
+/* Registry of the threads whose stacks are known.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _THREADREG_H
+#define _THREADREG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Registers the calling thread, whose stack starts at BASE, is mapped up to
+   MAPPED and can grow up to LIMIT, and whose alternate stack is
+   [EXTRA_STACK, EXTRA_STACK+EXTRA_STACK_SIZE).  If the thread is already
+   registered, updates its stack.  Returns 0 or -1.  */
+extern int sigsegv_thread_add (uintptr_t base, uintptr_t limit,
+                               uintptr_t mapped,
+                               uintptr_t extra_stack, size_t extra_stack_size);
+
+/* Unregisters the calling thread.  */
+extern void sigsegv_thread_remove (void);
+
+/* Tells the registry that the calling thread now runs on the stack that
+   starts at BASE, is mapped up to MAPPED and can grow up to LIMIT, or on its
+   own stack if BASE is 0.  */
+extern void sigsegv_thread_set_stack (uintptr_t base, uintptr_t limit,
+                                      uintptr_t mapped);
+
+/* Tells the registry that the stack the calling thread runs on is now mapped
+   up to MAPPED.  Ignored if MAPPED does not lie in that stack or if the stack
+   was already known to be mapped that far.  */
+extern void sigsegv_thread_set_mapped (uintptr_t mapped);
+
+/* Records that the calling thread is parked at the safepoint, with stack
+   pointer SP (0 if unknown).  Must be called from the signal handler.  */
+extern void sigsegv_thread_park (uintptr_t sp);
+
+/* Records that the calling thread is no longer parked.  */
+extern void sigsegv_thread_unpark (void);
+
+/* The type of a callback for sigsegv_thread_for_each_stack.  It gets the
+   index of the thread, the start and the limit of the stack the thread runs
+   on, and, if the thread is parked with a known stack pointer and nothing
+   beyond it is in use, the end of the part in use, else 0.  */
+typedef void (*sigsegv_thread_stack_callback_t) (void *arg, unsigned int index,
+                                                 uintptr_t base,
+                                                 uintptr_t limit,
+                                                 uintptr_t trim_bound);
+
+/* Calls CALLBACK for each registered thread, in the order of
+   sigsegv_thread_stack_ranges.  Returns the number of threads.  */
+extern unsigned int sigsegv_thread_for_each_stack
+  (sigsegv_thread_stack_callback_t callback, void *arg);
+
+#endif /* _THREADREG_H */
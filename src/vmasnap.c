@@ -0,0 +1,302 @@
+/* Snapshot of the virtual memory areas.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "vmasnap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if (defined _WIN32 && !defined __CYGWIN__) || !HAVE_STACKVMA
+
+/* sigsegv_vma_iterate is not supported here.  */
+
+int
+sigsegv_vma_snapshot_enable (int enable)
+{
+  return (enable ? -1 : 0);
+}
+
+void
+sigsegv_vma_snapshot_invalidate (void)
+{
+}
+
+int
+sigsegv_vma_snapshot_lookup (uintptr_t address,
+                             struct vma_snapshot_entry *vma,
+                             uintptr_t *prev_end, uintptr_t *next_start)
+{
+  return -1;
+}
+
+#else
+
+#include <string.h> /* strcmp */
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if !(HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS)
+# include <fcntl.h>
+#endif
+
+#include "atomic.h"
+
+/* DragonFly BSD 3.8 still has only MAP_ANON and not MAP_ANONYMOUS.  */
+#if HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS
+# define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* The snapshot is an array of the areas, sorted by address, in memory
+   obtained from mmap(), so that it can be refreshed in a signal handler.
+   It is protected by a seqlock: a refresh makes SEQ odd, writes the array,
+   and makes SEQ even again; a lookup searches the array and then verifies
+   that SEQ has not changed in between.  A lookup never waits, because it
+   may have interrupted a refresh in the same thread; it gives up instead.
+   When the array needs to grow, the old array is not unmapped, because a
+   lookup in another thread may still be reading it.  Since the array
+   doubles each time, this wastes at most as much memory as is in use.
+   The main stack grows without a call that would make the snapshot stale,
+   so its entry is marked, and a lookup that finds it gives up as well.  */
+
+struct snapshot
+{
+  /* The number of entries the array has room for.  Never changes.  */
+  size_t capacity;
+  /* The number of entries in use.  */
+  size_t count;
+  /* Followed by the entries.  */
+};
+
+#define SNAPSHOT_ENTRIES(snap) ((struct vma_snapshot_entry *) ((snap) + 1))
+
+#define INITIAL_CAPACITY 1024
+
+static volatile unsigned int enabled;
+/* Nonzero when the memory layout may have changed since the last refresh.  */
+static volatile unsigned int stale = 1;
+/* The sequence counter of the seqlock.  */
+static volatile unsigned int seq;
+/* Nonzero while a refresh is in progress.  */
+static volatile unsigned int refresh_busy;
+static struct snapshot *volatile current;
+/* The buffer for the names of the areas during a refresh.  Large enough for
+   a file name, so that the kernel does not reject it as too long.  */
+static char name_buf[4096];
+
+/* Allocates a snapshot with room for CAPACITY entries.  Returns NULL upon
+   failure.  */
+static struct snapshot *
+allocate_snapshot (size_t capacity)
+{
+  size_t size = sizeof (struct snapshot)
+                + capacity * sizeof (struct vma_snapshot_entry);
+  void *mem;
+
+#if HAVE_MMAP_ANON || HAVE_MMAP_ANONYMOUS
+  mem = mmap (NULL, size, PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+#else
+  {
+    int fd = open ("/dev/zero", O_RDONLY, 0644);
+    if (fd < 0)
+      return NULL;
+    mem = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+  }
+#endif
+  if (mem == (void *) -1)
+    return NULL;
+  ((struct snapshot *) mem)->capacity = capacity;
+  ((struct snapshot *) mem)->count = 0;
+  return (struct snapshot *) mem;
+}
+
+/* A callback for sigsegv_vma_iterate: appends an area to the snapshot.  */
+static int
+add_entry (void *user_arg, const sigsegv_vma *vma)
+{
+  struct snapshot *snap = current;
+  struct vma_snapshot_entry *e;
+
+  if (snap->count == snap->capacity)
+    {
+      struct snapshot *bigger = allocate_snapshot (2 * snap->capacity);
+      size_t i;
+
+      if (bigger == NULL)
+        {
+          *(int *) user_arg = -1;
+          return 1;
+        }
+      for (i = 0; i < snap->count; i++)
+        SNAPSHOT_ENTRIES (bigger)[i] = SNAPSHOT_ENTRIES (snap)[i];
+      bigger->count = snap->count;
+      sv_atomic_store (&current, bigger);
+      snap = bigger;
+      /* The new array may have changed the memory layout.  */
+      sv_atomic_store (&stale, 1);
+    }
+  e = &SNAPSHOT_ENTRIES (snap)[snap->count];
+  e->start = (uintptr_t) vma->start;
+  e->end = (uintptr_t) vma->end;
+  e->prot = vma->prot;
+  e->grows = (vma->name != NULL && strcmp (vma->name, "[stack]") == 0);
+  snap->count++;
+  return 0;
+}
+
+/* Rereads the memory layout into the snapshot.  Returns 0, or -1 if another
+   refresh is in progress or the layout cannot be read.  */
+static int
+refresh (void)
+{
+  int ret = 0;
+
+  if (!sv_atomic_compare_and_swap (&refresh_busy, 0, 1))
+    return -1;
+  sv_atomic_fetch_add (&seq, 1);
+  /* A change of the layout from now on makes the new snapshot stale.  */
+  sv_atomic_store (&stale, 0);
+  current->count = 0;
+  if (sigsegv_vma_iterate (add_entry, &ret, name_buf, sizeof (name_buf)) < 0)
+    ret = -1;
+  if (ret < 0)
+    {
+      current->count = 0;
+      sv_atomic_store (&stale, 1);
+    }
+  sv_atomic_fetch_add (&seq, 1);
+  sv_atomic_store (&refresh_busy, 0);
+  return ret;
+}
+
+/* Searches ADDRESS in the snapshot, like sigsegv_vma_snapshot_lookup.
+   Returns -1 if a refresh interfered or ADDRESS is in the main stack.  */
+static int
+search (uintptr_t address, struct vma_snapshot_entry *vma,
+        uintptr_t *prev_end, uintptr_t *next_start)
+{
+  unsigned int s = sv_atomic_load (&seq);
+  struct snapshot *snap;
+  const volatile struct vma_snapshot_entry *entries;
+  size_t count;
+  size_t lo, hi;
+  int ret;
+
+  if (s & 1)
+    return -1;
+  snap = sv_atomic_load (&current);
+  entries = SNAPSHOT_ENTRIES (snap);
+  /* While a refresh is in progress, COUNT may belong to another array.  */
+  count = snap->count;
+  if (count > snap->capacity)
+    count = snap->capacity;
+  /* Find the first area that ends after ADDRESS.  */
+  lo = 0;
+  hi = count;
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (entries[mid].end - 1 < address)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  if (lo < count && entries[lo].start <= address)
+    {
+      if (entries[lo].grows)
+        /* The main stack may have grown since the refresh.  */
+        return -1;
+      vma->start = entries[lo].start;
+      vma->end = entries[lo].end;
+      vma->prot = entries[lo].prot;
+      *prev_end = (lo > 0 ? entries[lo - 1].end : 0);
+      *next_start = (lo + 1 < count ? entries[lo + 1].start : 0);
+      ret = 0;
+    }
+  else
+    ret = 1;
+  /* The fetch_add is a full barrier: it orders the reads above before the
+     verification.  */
+  if (sv_atomic_fetch_add (&seq, 0) != s)
+    return -1;
+  return ret;
+}
+
+int
+sigsegv_vma_snapshot_lookup (uintptr_t address,
+                             struct vma_snapshot_entry *vma,
+                             uintptr_t *prev_end, uintptr_t *next_start)
+{
+  int refreshed = 0;
+  int ret;
+
+  if (!sv_atomic_load (&enabled))
+    return -1;
+  if (sv_atomic_load (&stale))
+    {
+      if (refresh () < 0)
+        return -1;
+      refreshed = 1;
+    }
+  ret = search (address, vma, prev_end, next_start);
+  if (ret == 1 && !refreshed)
+    {
+      /* The area may have been mapped since the last refresh.  */
+      if (refresh () < 0)
+        return -1;
+      ret = search (address, vma, prev_end, next_start);
+    }
+  return ret;
+}
+
+int
+sigsegv_vma_snapshot_enable (int enable)
+{
+  if (!enable)
+    {
+      sv_atomic_store (&enabled, 0);
+      return 0;
+    }
+  if (sv_atomic_load (&current) == NULL)
+    {
+      struct snapshot *snap = allocate_snapshot (INITIAL_CAPACITY);
+
+      if (snap == NULL)
+        return -1;
+      if (!sv_atomic_compare_and_swap (&current, NULL, snap))
+        munmap ((void *) snap, sizeof (struct snapshot)
+                               + INITIAL_CAPACITY
+                                 * sizeof (struct vma_snapshot_entry));
+    }
+  sv_atomic_store (&stale, 1);
+  if (refresh () < 0)
+    return -1;
+  sv_atomic_store (&enabled, 1);
+  return 0;
+}
+
+void
+sigsegv_vma_snapshot_invalidate (void)
+{
+  sv_atomic_store (&stale, 1);
+}
+
+#endif
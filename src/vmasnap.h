@@ -0,0 +1,44 @@
+/* Snapshot of the virtual memory areas.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _VMASNAP_H
+#define _VMASNAP_H
+
+#include <stdint.h>
+
+/* A virtual memory area in the snapshot.  */
+struct vma_snapshot_entry
+{
+  uintptr_t start;
+  uintptr_t end;
+  int prot;
+  /* Nonzero for the main stack, which grows on demand.  */
+  int grows;
+};
+
+/* Looks up ADDRESS in the snapshot of the virtual memory areas, refreshing
+   the snapshot when it is stale or does not contain ADDRESS.  Stores the
+   area in *VMA, the end of the previous area (or 0) in *PREV_END, and the
+   start of the next area (or 0) in *NEXT_START.
+   Returns 0 if found, 1 if ADDRESS is not mapped, or -1 if the snapshot is
+   disabled or cannot be used now, or if ADDRESS is in the main stack, whose
+   start in the snapshot may be out of date.  Async-signal-safe.  */
+extern int sigsegv_vma_snapshot_lookup (uintptr_t address,
+                                        struct vma_snapshot_entry *vma,
+                                        uintptr_t *prev_end,
+                                        uintptr_t *next_start);
+
+#endif /* _VMASNAP_H */
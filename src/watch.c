@@ -0,0 +1,381 @@
+/* Data watchpoints through page protection.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+#include "dispatcher.h"
+#include "watch.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented: there is no single-stepping on Windows.  */
+
+void *
+sigsegv_watch_add (void *address, size_t len, int flags,
+                   sigsegv_watch_handler_t handler, void *handler_arg)
+{
+  return NULL;
+}
+
+void
+sigsegv_watch_remove (void *ticket)
+{
+}
+
+int
+sigsegv_watch_exists (void)
+{
+  return 0;
+}
+
+int
+sigsegv_watch_fault (void *fault_address)
+{
+  return 0;
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+/* The watchpoints are organized by page.  Each watched page is registered
+   as a SIGSEGV_AREA_SINGLESTEP area of watch_dispatcher and has a list of
+   the watchpoints that overlap it.  When a fault occurs on a watched page,
+   the access is first compared against the bounding interval of these
+   watchpoints, so that accesses to unwatched bytes of the page take the
+   fastest possible path.  */
+
+struct watch
+{
+  uintptr_t start;
+  uintptr_t end;
+  int flags;
+  sigsegv_watch_handler_t handler;
+  void *handler_arg;
+};
+
+struct watched_page
+{
+  uintptr_t page;
+  /* The ticket in watch_dispatcher.  */
+  void *ticket;
+  /* Nonzero if the page is protected with PROT_READ, because all
+     watchpoints on it are SIGSEGV_WATCH_WRITE.  */
+  int readonly;
+  /* The bounding interval [lo, hi) of the watched bytes.  */
+  uintptr_t lo;
+  uintptr_t hi;
+  /* The watchpoints that overlap the page.  */
+  unsigned int count;
+  unsigned int alloc;
+  struct watch **watches;
+};
+
+/* The maximum size of a memory access, for the fast path.  An access that
+   starts this many bytes before a watched interval cannot hit it.  */
+#define MAX_ACCESS_SIZE 64
+
+static sigsegv_dispatcher watch_dispatcher;
+static unsigned int watch_count;
+static uintptr_t pagesize;
+
+/* The area handler for a watched page.  */
+static int
+page_handler (void *fault_address, void *arg)
+{
+  struct watched_page *wp = (struct watched_page *) arg;
+  uintptr_t addr = (uintptr_t) fault_address;
+  uintptr_t end;
+  int is_write;
+  sigsegv_access access;
+  unsigned int i;
+
+  /* Fast path.  The faulting instruction will be stepped.  */
+  if (addr >= wp->hi || addr + MAX_ACCESS_SIZE <= wp->lo)
+    return 1;
+
+  if (sigsegv_decode_access (&access) == 0)
+    {
+      addr = (uintptr_t) access.address;
+      end = addr + access.size;
+      is_write = access.is_write;
+    }
+  else
+    {
+      /* The access width is not known.  Consider only its first byte.  */
+      end = addr + 1;
+      is_write = (wp->readonly ? 1 : -1);
+    }
+  for (i = 0; i < wp->count; i++)
+    {
+      struct watch *w = wp->watches[i];
+
+      if (addr < w->end && w->start < end
+          && !((w->flags & SIGSEGV_WATCH_WRITE) && is_write == 0))
+        (*w->handler) ((void *) addr, is_write, w->handler_arg);
+    }
+  return 1;
+}
+
+/* Registers the page WP in watch_dispatcher.  Returns the ticket, or NULL.  */
+static void *
+register_page (struct watched_page *wp, int readonly)
+{
+  return sigsegv_register_flags (&watch_dispatcher, (void *) wp->page,
+                                 pagesize, &page_handler, wp,
+                                 SIGSEGV_AREA_SINGLESTEP
+                                 | (readonly ? SIGSEGV_AREA_READONLY : 0));
+}
+
+/* Recomputes the bounding interval and protection of WP, and registers it
+   with the right flags.  Returns 0, or -1 if WP is left registered and
+   protected as before.  */
+static int
+update_page (struct watched_page *wp)
+{
+  uintptr_t lo = wp->page + pagesize;
+  uintptr_t hi = wp->page;
+  int readonly = 1;
+  unsigned int i;
+
+  for (i = 0; i < wp->count; i++)
+    {
+      struct watch *w = wp->watches[i];
+
+      if (w->start < lo)
+        lo = w->start;
+      if (w->end > hi)
+        hi = w->end;
+      if (!(w->flags & SIGSEGV_WATCH_WRITE))
+        readonly = 0;
+    }
+
+  if (wp->ticket == NULL)
+    {
+      wp->ticket = register_page (wp, readonly);
+      if (wp->ticket == NULL)
+        return -1;
+      if (mprotect ((void *) wp->page, pagesize,
+                    readonly ? PROT_READ : PROT_NONE) < 0)
+        {
+          sigsegv_unregister (&watch_dispatcher, wp->ticket);
+          wp->ticket = NULL;
+          return -1;
+        }
+      sigsegv_vma_snapshot_invalidate ();
+      wp->readonly = readonly;
+    }
+  else if (readonly != wp->readonly)
+    {
+      /* The dispatcher does not support two areas with the same start
+         address.  Therefore unregister the page before registering it with
+         other flags, and register it again with the old flags if that
+         fails.  Registering with the old flags succeeds, because the
+         single-stepping is already initialized.  */
+      void *ticket;
+
+      sigsegv_unregister (&watch_dispatcher, wp->ticket);
+      ticket = register_page (wp, readonly);
+      if (ticket == NULL)
+        {
+          wp->ticket = register_page (wp, wp->readonly);
+          return -1;
+        }
+      if (mprotect ((void *) wp->page, pagesize,
+                    readonly ? PROT_READ : PROT_NONE) < 0)
+        {
+          sigsegv_unregister (&watch_dispatcher, ticket);
+          wp->ticket = register_page (wp, wp->readonly);
+          return -1;
+        }
+      wp->ticket = ticket;
+      sigsegv_vma_snapshot_invalidate ();
+      wp->readonly = readonly;
+    }
+  wp->lo = (lo < wp->page ? wp->page : lo);
+  wp->hi = (hi > wp->page + pagesize ? wp->page + pagesize : hi);
+  return 0;
+}
+
+/* Returns the watched_page for PAGE, or NULL.  */
+static struct watched_page *
+lookup_page (uintptr_t page)
+{
+  sigsegv_area_handler_t handler;
+  void *arg;
+
+  if (sigsegv_dispatcher_lookup (&watch_dispatcher, (void *) page,
+                                 &handler, &arg))
+    return (struct watched_page *) arg;
+  return NULL;
+}
+
+/* Removes W from the page PAGE.  */
+static void
+remove_from_page (struct watch *w, uintptr_t page)
+{
+  struct watched_page *wp = lookup_page (page);
+  unsigned int i;
+
+  if (wp == NULL)
+    return;
+  for (i = 0; i < wp->count; i++)
+    if (wp->watches[i] == w)
+      {
+        wp->watches[i] = wp->watches[--wp->count];
+        break;
+      }
+  if (wp->count == 0)
+    {
+      sigsegv_unregister (&watch_dispatcher, wp->ticket);
+      mprotect ((void *) page, pagesize, PROT_READ | PROT_WRITE);
+      sigsegv_vma_snapshot_invalidate ();
+      free (wp->watches);
+      free (wp);
+    }
+  else
+    /* If this fails, the page stays protected for the removed watchpoint
+       as well, and page_handler ignores the faults that only it would
+       catch.  */
+    update_page (wp);
+}
+
+/* Adds W to the page PAGE.  Returns 0 or -1.  */
+static int
+add_to_page (struct watch *w, uintptr_t page)
+{
+  struct watched_page *wp = lookup_page (page);
+
+  if (wp == NULL)
+    {
+      wp = (struct watched_page *) malloc (sizeof (struct watched_page));
+      if (wp == NULL)
+        return -1;
+      wp->page = page;
+      wp->ticket = NULL;
+      wp->readonly = 0;
+      wp->count = 0;
+      wp->alloc = 0;
+      wp->watches = NULL;
+    }
+  if (wp->count == wp->alloc)
+    {
+      unsigned int new_alloc = (wp->alloc == 0 ? 4 : 2 * wp->alloc);
+      struct watch **new_watches =
+        (struct watch **) realloc (wp->watches,
+                                   new_alloc * sizeof (struct watch *));
+      if (new_watches == NULL)
+        goto fail;
+      wp->watches = new_watches;
+      wp->alloc = new_alloc;
+    }
+  wp->watches[wp->count++] = w;
+  if (update_page (wp) < 0)
+    {
+      wp->count--;
+      goto fail;
+    }
+  return 0;
+
+ fail:
+  /* A page that has other watchpoints stays as it was.  */
+  if (wp->count == 0 && wp->ticket == NULL)
+    {
+      free (wp->watches);
+      free (wp);
+    }
+  return -1;
+}
+
+void *
+sigsegv_watch_add (void *address, size_t len, int flags,
+                   sigsegv_watch_handler_t handler, void *handler_arg)
+{
+  struct watch *w;
+  uintptr_t page;
+
+  if (len == 0)
+    return NULL;
+  if (pagesize == 0)
+    {
+#if HAVE_GETPAGESIZE
+      pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+      pagesize = sysconf (_SC_PAGESIZE);
+#else
+      pagesize = PAGESIZE;
+#endif
+      sigsegv_init (&watch_dispatcher);
+    }
+
+  w = (struct watch *) malloc (sizeof (struct watch));
+  if (w == NULL)
+    return NULL;
+  w->start = (uintptr_t) address;
+  w->end = (uintptr_t) address + len;
+  w->flags = flags;
+  w->handler = handler;
+  w->handler_arg = handler_arg;
+
+  for (page = w->start & -pagesize; page < w->end; page += pagesize)
+    if (add_to_page (w, page) < 0)
+      {
+        uintptr_t p;
+
+        for (p = w->start & -pagesize; p < page; p += pagesize)
+          remove_from_page (w, p);
+        free (w);
+        return NULL;
+      }
+  watch_count++;
+  return w;
+}
+
+void
+sigsegv_watch_remove (void *ticket)
+{
+  struct watch *w = (struct watch *) ticket;
+  uintptr_t page;
+
+  if (w == NULL)
+    return;
+  for (page = w->start & -pagesize; page < w->end; page += pagesize)
+    remove_from_page (w, page);
+  free (w);
+  watch_count--;
+}
+
+int
+sigsegv_watch_exists (void)
+{
+  return watch_count > 0;
+}
+
+int
+sigsegv_watch_fault (void *fault_address)
+{
+  if (watch_count == 0)
+    return 0;
+  return sigsegv_dispatch (&watch_dispatcher, fault_address);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/* Data watchpoints through page protection.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _WATCH_H
+#define _WATCH_H
+
+/* Adds a watchpoint and protects the pages it covers.
+   Returns a ticket, or NULL upon failure.  */
+extern void *sigsegv_watch_add (void *address, size_t len, int flags,
+                                sigsegv_watch_handler_t handler,
+                                void *handler_arg);
+
+/* Removes a watchpoint and unprotects the pages that are no longer
+   watched.  */
+extern void sigsegv_watch_remove (void *ticket);
+
+/* Returns nonzero if some watchpoint is set.  */
+extern int sigsegv_watch_exists (void);
+
+/* Called by the fault handler.  If FAULT_ADDRESS lies in a watched page,
+   calls the handlers of the watchpoints that the access hits, arranges for
+   the access to be single-stepped, and returns 1.  Otherwise returns 0.  */
+extern int sigsegv_watch_fault (void *fault_address);
+
+#endif /* _WATCH_H */
@@ -0,0 +1,869 @@
+/* Tracking of the pages that are written to.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#include "config.h"
+
+#include "sigsegv.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined _WIN32 && !defined __CYGWIN__
+
+/* Not implemented: Windows has no mprotect().  */
+
+void *
+sigsegv_wtrack_register (sigsegv_dispatcher *dispatcher,
+                         void *address, size_t len)
+{
+  return NULL;
+}
+
+void *
+sigsegv_wtrack_register_flags (sigsegv_dispatcher *dispatcher,
+                               void *address, size_t len, int flags)
+{
+  return NULL;
+}
+
+int
+sigsegv_wtrack_get_flags (void *ticket)
+{
+  return 0;
+}
+
+void
+sigsegv_wtrack_unregister (void *ticket)
+{
+}
+
+int
+sigsegv_wtrack_is_dirty (void *ticket, void *address)
+{
+  return -1;
+}
+
+long
+sigsegv_wtrack_collect (void *ticket, sigsegv_wtrack_callback_t callback,
+                        void *user_arg)
+{
+  return -1;
+}
+
+#else
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#if defined __linux__ || defined __ANDROID__
+# include <fcntl.h>
+#endif
+#if (defined __linux__ || defined __ANDROID__) && HAVE_LINUX_USERFAULTFD_H && HAVE_PTHREAD_CREATE
+# include <errno.h>
+# include <string.h>
+# include <pthread.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <linux/userfaultfd.h>
+# if defined UFFDIO_WRITEPROTECT && defined __NR_userfaultfd /* Linux >= 5.7 */
+#  define USE_USERFAULTFD 1
+/* Linux >= 6.4 can write-protect pages that are not populated yet.  */
+#  ifndef UFFD_FEATURE_WP_UNPOPULATED
+#   define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#  endif
+# endif
+#endif
+
+#include "atomic.h"
+
+/* Every area has a bitmap with one bit per page, which is set when the page
+   is dirty.  Clean pages are read-only, dirty pages are writable.  The
+   bitmap and the protection of the pages are changed together, under the
+   area's lock.
+   For an area with SIGSEGV_WTRACK_SOFT_DIRTY, the pages stay writable, and
+   the bitmap accumulates the soft-dirty bits of the pages, under the lock
+   soft_dirty_lock.
+   For an area with SIGSEGV_WTRACK_USERFAULTFD, clean pages are
+   write-protected through userfaultfd() instead of mprotect().  */
+
+#define WORD_BITS (sizeof (unsigned long) * CHAR_BIT)
+
+struct wtrack_area
+{
+  /* Link in the list of the areas with SIGSEGV_WTRACK_SOFT_DIRTY or with
+     SIGSEGV_WTRACK_USERFAULTFD.  */
+  struct wtrack_area *next;
+  sigsegv_dispatcher *dispatcher;
+  /* The ticket in the dispatcher, or NULL.  */
+  void *ticket;
+  /* The flags that are in effect.  */
+  int flags;
+  uintptr_t start;
+  size_t npages;
+  volatile unsigned int lock;
+  /* The dirty pages.  */
+  unsigned long *dirty;
+  /* The dirty pages that the last sigsegv_wtrack_collect took.  */
+  unsigned long *collected;
+};
+
+static uintptr_t pagesize;
+
+static void
+spin_lock (volatile unsigned int *lock)
+{
+  while (!sv_atomic_compare_and_swap (lock, 0, 1))
+    ;
+}
+
+static void
+spin_unlock (volatile unsigned int *lock)
+{
+  sv_atomic_store (lock, 0);
+}
+
+/* Returns the index of the lowest bit that is set in X, which is nonzero.  */
+static unsigned int
+lowest_bit (unsigned long x)
+{
+#if __GNUC__ >= 4 || defined __clang__
+  return __builtin_ctzl (x);
+#else
+  unsigned int i = 0;
+  while ((x & 1) == 0)
+    {
+      x >>= 1;
+      i++;
+    }
+  return i;
+#endif
+}
+
+/* Returns the index of the first bit at or after I in the bitmap WORDS of
+   NBITS bits that is equal to VALUE, or NBITS if there is none.  The bitmap
+   is scanned a word at a time, so that a run of 0 bits, i.e. of clean pages,
+   costs one comparison per WORD_BITS pages.  */
+static size_t
+find_bit (const unsigned long *words, size_t nbits, size_t i, int value)
+{
+  unsigned long flip = (value ? 0 : ~0UL);
+  size_t nwords = (nbits + WORD_BITS - 1) / WORD_BITS;
+  size_t w;
+  unsigned long x;
+
+  if (i >= nbits)
+    return nbits;
+  w = i / WORD_BITS;
+  x = (words[w] ^ flip) & (~0UL << (i % WORD_BITS));
+  while (x == 0)
+    {
+      if (++w == nwords)
+        return nbits;
+      x = words[w] ^ flip;
+    }
+  i = w * WORD_BITS + lowest_bit (x);
+  return (i < nbits ? i : nbits);
+}
+
+/* The area handler: marks the page that faulted as dirty and makes it
+   writable.  */
+static int
+wtrack_area_handler (void *fault_address, void *arg)
+{
+  struct wtrack_area *area = (struct wtrack_area *) arg;
+  size_t page = ((uintptr_t) fault_address - area->start) / pagesize;
+  unsigned long bit = 1UL << (page % WORD_BITS);
+  int ret = 1;
+
+  if (page >= area->npages)
+    return 0;
+  spin_lock (&area->lock);
+  /* If the page is already dirty, another thread has made it writable, and
+     the access can be retried.  */
+  if ((area->dirty[page / WORD_BITS] & bit) == 0)
+    {
+      if (mprotect ((void *) (area->start + page * pagesize), pagesize,
+                    PROT_READ | PROT_WRITE) < 0)
+        ret = 0;
+      else
+        {
+          area->dirty[page / WORD_BITS] |= bit;
+          sigsegv_vma_snapshot_invalidate ();
+        }
+    }
+  spin_unlock (&area->lock);
+  return ret;
+}
+
+/* Moves the dirty pages of AREA to its set of collected pages.  */
+static void
+take_dirty (struct wtrack_area *area)
+{
+  size_t nwords = (area->npages + WORD_BITS - 1) / WORD_BITS;
+  size_t w;
+
+  for (w = 0; w < nwords; w++)
+    {
+      area->collected[w] = area->dirty[w];
+      area->dirty[w] = 0;
+    }
+}
+
+#if defined __linux__ || defined __ANDROID__
+
+/* The kernel sets the soft-dirty bit of a page when the page is written to.
+   It is bit 55 of the page's 64-bit entry in /proc/self/pagemap.  Writing
+   "4" to /proc/self/clear_refs clears the soft-dirty bits of all pages of
+   the process.  Therefore, before the bits are cleared, they are accumulated
+   in the bitmaps of all areas that use them.  */
+
+# define PM_SOFT_DIRTY 55
+
+/* The number of pagemap entries read at once.  A multiple of WORD_BITS.  */
+# define PAGEMAP_BATCH 512
+
+static int pagemap_fd = -1;
+static int clear_refs_fd = -1;
+
+/* 1 if soft-dirty bits work, -1 if not, 0 if not yet known.  */
+static int soft_dirty_state;
+
+/* The list of the areas with SIGSEGV_WTRACK_SOFT_DIRTY, and a spin lock that
+   protects it and their bitmaps.  */
+static struct wtrack_area *soft_dirty_areas;
+static volatile unsigned int soft_dirty_lock;
+
+/* Reads the pagemap entries of the NPAGES pages at ADDRESS into BUF.
+   Returns 0, or -1 in case of error.  */
+static int
+read_pagemap (uintptr_t address, size_t npages, uint64_t *buf)
+{
+  off_t offset = (off_t) (address / pagesize) * sizeof (uint64_t);
+  char *p = (char *) buf;
+  size_t size = npages * sizeof (uint64_t);
+
+  while (size > 0)
+    {
+      ssize_t n = pread (pagemap_fd, p, size, offset);
+      if (n <= 0)
+        return -1;
+      p += n;
+      size -= n;
+      offset += n;
+    }
+  return 0;
+}
+
+/* Clears the soft-dirty bits of all pages.  Returns 0, or -1 in case of
+   error.  */
+static int
+clear_soft_dirty (void)
+{
+  return (write (clear_refs_fd, "4", 1) == 1 ? 0 : -1);
+}
+
+/* Adds the soft-dirty bits of the pages of AREA to its bitmap.
+   Returns 0, or -1 in case of error.  */
+static int
+read_soft_dirty (struct wtrack_area *area)
+{
+  uint64_t buf[PAGEMAP_BATCH];
+  size_t i, k;
+
+  for (i = 0; i < area->npages; i += PAGEMAP_BATCH)
+    {
+      size_t n = area->npages - i;
+
+      if (n > PAGEMAP_BATCH)
+        n = PAGEMAP_BATCH;
+      if (read_pagemap (area->start + i * pagesize, n, buf) < 0)
+        return -1;
+      /* Pack the bits into bitmap words.  The inner loop has no branches, so
+         that compilers can vectorize it.  */
+      for (k = 0; k < n; k += WORD_BITS)
+        {
+          size_t m = (n - k < WORD_BITS ? n - k : WORD_BITS);
+          unsigned long word = 0;
+          size_t b;
+
+          for (b = 0; b < m; b++)
+            word |= (unsigned long) ((buf[k + b] >> PM_SOFT_DIRTY) & 1) << b;
+          area->dirty[(i + k) / WORD_BITS] |= word;
+        }
+    }
+  return 0;
+}
+
+/* Adds the soft-dirty bits of all areas with SIGSEGV_WTRACK_SOFT_DIRTY to
+   their bitmaps, and clears them.  Must be called with soft_dirty_lock held.
+   Returns 0, or -1 in case of error.  */
+static int
+harvest_soft_dirty (void)
+{
+  struct wtrack_area *area;
+
+  for (area = soft_dirty_areas; area != NULL; area = area->next)
+    if (read_soft_dirty (area) < 0)
+      return -1;
+  return clear_soft_dirty ();
+}
+
+/* Determines whether soft-dirty bits work.  Must be called with
+   soft_dirty_lock held, while no area uses them.  */
+static int
+soft_dirty_init (void)
+{
+  if (soft_dirty_state == 0)
+    {
+      int state = -1;
+
+      pagemap_fd = open ("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+      clear_refs_fd = open ("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+      if (pagemap_fd >= 0 && clear_refs_fd >= 0)
+        {
+          /* Without CONFIG_MEM_SOFT_DIRTY, the kernel accepts the files, but
+             the bits stay 0.  Therefore check that a write to a page sets
+             its bit.  */
+          volatile char *page =
+            (volatile char *) mmap (NULL, pagesize, PROT_READ | PROT_WRITE,
+                                    MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+          uint64_t entry;
+
+          if (page != (volatile char *) MAP_FAILED)
+            {
+              page[0] = 1;
+              if (clear_soft_dirty () == 0
+                  && read_pagemap ((uintptr_t) page, 1, &entry) == 0
+                  && ((entry >> PM_SOFT_DIRTY) & 1) == 0)
+                {
+                  page[0] = 2;
+                  if (read_pagemap ((uintptr_t) page, 1, &entry) == 0
+                      && ((entry >> PM_SOFT_DIRTY) & 1) == 1)
+                    state = 1;
+                }
+              munmap ((void *) page, pagesize);
+            }
+        }
+      if (state < 0)
+        {
+          if (pagemap_fd >= 0)
+            close (pagemap_fd);
+          if (clear_refs_fd >= 0)
+            close (clear_refs_fd);
+        }
+      soft_dirty_state = state;
+    }
+  return soft_dirty_state > 0;
+}
+
+/* Starts tracking the writes to AREA through soft-dirty bits.
+   Returns 0, or -1 if they don't work.  */
+static int
+soft_dirty_register (struct wtrack_area *area)
+{
+  int ret = -1;
+
+  spin_lock (&soft_dirty_lock);
+  /* The bits of the pages of AREA are cleared along with the others.  */
+  if ((soft_dirty_areas != NULL || soft_dirty_init ())
+      && harvest_soft_dirty () == 0)
+    {
+      area->next = soft_dirty_areas;
+      soft_dirty_areas = area;
+      ret = 0;
+    }
+  spin_unlock (&soft_dirty_lock);
+  return ret;
+}
+
+static void
+soft_dirty_unregister (struct wtrack_area *area)
+{
+  struct wtrack_area **p;
+
+  spin_lock (&soft_dirty_lock);
+  for (p = &soft_dirty_areas; *p != NULL; p = &(*p)->next)
+    if (*p == area)
+      {
+        *p = area->next;
+        break;
+      }
+  spin_unlock (&soft_dirty_lock);
+}
+
+/* Moves the dirty pages of AREA, including those whose soft-dirty bit is
+   set, to its set of collected pages.  Returns 0, or -1 in case of error.  */
+static int
+soft_dirty_take (struct wtrack_area *area)
+{
+  int ret = -1;
+
+  spin_lock (&soft_dirty_lock);
+  if (harvest_soft_dirty () == 0)
+    {
+      take_dirty (area);
+      ret = 0;
+    }
+  spin_unlock (&soft_dirty_lock);
+  return ret;
+}
+
+/* Returns the soft-dirty bit of the page PAGE of AREA, or 0 in case of
+   error.  */
+static int
+soft_dirty_bit (struct wtrack_area *area, size_t page)
+{
+  uint64_t entry;
+
+  if (read_pagemap (area->start + page * pagesize, 1, &entry) < 0)
+    return 0;
+  return (entry >> PM_SOFT_DIRTY) & 1;
+}
+
+#else
+
+# define soft_dirty_register(area) (-1)
+# define soft_dirty_unregister(area) ((void) 0)
+# define soft_dirty_bit(area, page) 0
+# define soft_dirty_take(area) (-1)
+
+#endif
+
+#if USE_USERFAULTFD
+
+/* The write faults in the areas that are registered with the userfaultfd()
+   file descriptor uffd are read from it by a service thread, which marks the
+   pages as dirty and removes their write protection; this wakes up the
+   thread that faulted.  */
+
+static int uffd = -1;
+
+/* Nonzero if the kernel supports UFFD_FEATURE_WP_UNPOPULATED.  */
+static int uffd_wp_unpopulated;
+
+/* 1 if userfaultfd() works, -1 if not, 0 if not yet known.  */
+static int uffd_state;
+
+/* The list of the areas with SIGSEGV_WTRACK_USERFAULTFD, and a spin lock
+   that protects it.  */
+static struct wtrack_area *uffd_areas;
+static volatile unsigned int uffd_lock;
+
+/* Returns a new userfaultfd() file descriptor, or -1.  */
+static int
+uffd_open (void)
+{
+  int fd = syscall (__NR_userfaultfd, O_CLOEXEC);
+
+# ifdef USERFAULTFD_IOC_NEW /* Linux >= 6.1 */
+  /* When vm.unprivileged_userfaultfd is 0, the system call is reserved to
+     privileged processes, but the access to /dev/userfaultfd may be
+     granted to others.  */
+  if (fd < 0 && (errno == EPERM || errno == ENOSYS))
+    {
+      int dev = open ("/dev/userfaultfd", O_RDWR | O_CLOEXEC);
+      if (dev >= 0)
+        {
+          fd = ioctl (dev, USERFAULTFD_IOC_NEW, O_CLOEXEC);
+          close (dev);
+        }
+    }
+# endif
+  return fd;
+}
+
+/* Sets (if PROTECT is nonzero) or removes the write protection of the
+   LEN bytes at ADDRESS.  Returns 0, or -1 in case of error.  */
+static int
+uffd_write_protect (uintptr_t address, size_t len, int protect)
+{
+  struct uffdio_writeprotect wp;
+
+  wp.range.start = address;
+  wp.range.len = len;
+  wp.mode = (protect ? UFFDIO_WRITEPROTECT_MODE_WP : 0);
+  return ioctl (uffd, UFFDIO_WRITEPROTECT, &wp);
+}
+
+/* Marks the page at ADDRESS as dirty, and removes its write protection.  */
+static void
+uffd_mark_dirty (uintptr_t address)
+{
+  struct wtrack_area *area;
+
+  spin_lock (&uffd_lock);
+  for (area = uffd_areas; area != NULL; area = area->next)
+    if (address - area->start < area->npages * pagesize)
+      break;
+  /* If the area has been unregistered meanwhile, the faulting thread has
+     been woken up already.  */
+  if (area != NULL)
+    {
+      size_t page = (address - area->start) / pagesize;
+
+      spin_lock (&area->lock);
+      area->dirty[page / WORD_BITS] |= 1UL << (page % WORD_BITS);
+      uffd_write_protect (area->start + page * pagesize, pagesize, 0);
+      spin_unlock (&area->lock);
+    }
+  spin_unlock (&uffd_lock);
+}
+
+/* The service thread.  It reads the fault messages in batches.  */
+static void *
+uffd_service (void *arg)
+{
+  for (;;)
+    {
+      struct uffd_msg msgs[16];
+      ssize_t n = read (uffd, msgs, sizeof (msgs));
+      size_t i;
+
+      if (n < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            continue;
+          break;
+        }
+      for (i = 0; i < n / sizeof (struct uffd_msg); i++)
+        if (msgs[i].event == UFFD_EVENT_PAGEFAULT
+            && (msgs[i].arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP))
+          uffd_mark_dirty (msgs[i].arg.pagefault.address & -pagesize);
+    }
+  return NULL;
+}
+
+/* Determines whether userfaultfd() works, and starts the service thread.
+   Must be called with uffd_lock held.  */
+static int
+uffd_init (void)
+{
+  if (uffd_state == 0)
+    {
+      int state = -1;
+      struct uffdio_api api;
+      int fd;
+
+      /* The features can be queried only once per file descriptor.  */
+      fd = uffd_open ();
+      if (fd >= 0)
+        {
+          memset (&api, 0, sizeof (api));
+          api.api = UFFD_API;
+          if (ioctl (fd, UFFDIO_API, &api) == 0)
+            uffd_wp_unpopulated =
+              (api.features & UFFD_FEATURE_WP_UNPOPULATED) != 0;
+          close (fd);
+        }
+      uffd = uffd_open ();
+      if (uffd >= 0)
+        {
+          pthread_attr_t attr;
+          pthread_t thread;
+
+          memset (&api, 0, sizeof (api));
+          api.api = UFFD_API;
+          api.features = UFFD_FEATURE_PAGEFAULT_FLAG_WP
+                         | (uffd_wp_unpopulated ? UFFD_FEATURE_WP_UNPOPULATED
+                                                : 0);
+          if (ioctl (uffd, UFFDIO_API, &api) == 0
+              && pthread_attr_init (&attr) == 0)
+            {
+              pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+              if (pthread_create (&thread, &attr, uffd_service, NULL) == 0)
+                state = 1;
+              pthread_attr_destroy (&attr);
+            }
+          if (state < 0)
+            close (uffd);
+        }
+      uffd_state = state;
+    }
+  return uffd_state > 0;
+}
+
+/* Starts tracking the writes to AREA through userfaultfd().
+   Returns 0, or -1 if it does not work.  */
+static int
+uffd_register (struct wtrack_area *area)
+{
+  size_t len = area->npages * pagesize;
+  int ret = -1;
+
+  spin_lock (&uffd_lock);
+  if (uffd_init ())
+    {
+      struct uffdio_register reg;
+
+      reg.range.start = area->start;
+      reg.range.len = len;
+      reg.mode = UFFDIO_REGISTER_MODE_WP;
+      if (ioctl (uffd, UFFDIO_REGISTER, &reg) == 0)
+        {
+          if ((reg.ioctls & ((__u64) 1 << _UFFDIO_WRITEPROTECT)) != 0)
+            {
+              /* Before Linux 6.4, only pages that are mapped can be
+                 write-protected.  Reading a page that was not populated yet
+                 maps the zero page, without allocating memory.  */
+              if (!uffd_wp_unpopulated)
+                {
+                  size_t i;
+
+                  for (i = 0; i < area->npages; i++)
+                    (void) *(volatile char *) (area->start + i * pagesize);
+                }
+              if (uffd_write_protect (area->start, len, 1) == 0)
+                {
+                  area->next = uffd_areas;
+                  uffd_areas = area;
+                  ret = 0;
+                }
+            }
+          if (ret < 0)
+            {
+              struct uffdio_range range;
+
+              range.start = area->start;
+              range.len = len;
+              ioctl (uffd, UFFDIO_UNREGISTER, &range);
+            }
+        }
+    }
+  spin_unlock (&uffd_lock);
+  return ret;
+}
+
+static void
+uffd_unregister (struct wtrack_area *area)
+{
+  struct wtrack_area **p;
+  struct uffdio_range range;
+
+  spin_lock (&uffd_lock);
+  for (p = &uffd_areas; *p != NULL; p = &(*p)->next)
+    if (*p == area)
+      {
+        *p = area->next;
+        break;
+      }
+  /* This also wakes up the threads that wait for a write fault in the
+     area to be handled.  */
+  uffd_write_protect (area->start, area->npages * pagesize, 0);
+  range.start = area->start;
+  range.len = area->npages * pagesize;
+  ioctl (uffd, UFFDIO_UNREGISTER, &range);
+  spin_unlock (&uffd_lock);
+}
+
+#else
+
+# define uffd_register(area) (-1)
+# define uffd_unregister(area) ((void) 0)
+# define uffd_write_protect(address, len, protect) (-1)
+
+#endif
+
+void *
+sigsegv_wtrack_register (sigsegv_dispatcher *dispatcher,
+                         void *address, size_t len)
+{
+  return sigsegv_wtrack_register_flags (dispatcher, address, len, 0);
+}
+
+void *
+sigsegv_wtrack_register_flags (sigsegv_dispatcher *dispatcher,
+                               void *address, size_t len, int flags)
+{
+  struct wtrack_area *area;
+  size_t nwords;
+
+  if (pagesize == 0)
+    {
+#if HAVE_GETPAGESIZE
+      pagesize = getpagesize ();
+#elif HAVE_SYSCONF_PAGESIZE
+      pagesize = sysconf (_SC_PAGESIZE);
+#else
+      pagesize = PAGESIZE;
+#endif
+    }
+  if (len == 0 || ((uintptr_t) address | len) & (pagesize - 1))
+    return NULL;
+
+  area = (struct wtrack_area *) malloc (sizeof (struct wtrack_area));
+  if (area == NULL)
+    return NULL;
+  area->npages = len / pagesize;
+  nwords = (area->npages + WORD_BITS - 1) / WORD_BITS;
+  area->dirty = (unsigned long *) calloc (2 * nwords, sizeof (unsigned long));
+  if (area->dirty == NULL)
+    goto fail1;
+  area->collected = area->dirty + nwords;
+  area->dispatcher = dispatcher;
+  area->start = (uintptr_t) address;
+  area->lock = 0;
+  area->ticket = NULL;
+
+  if ((flags & SIGSEGV_WTRACK_USERFAULTFD) && uffd_register (area) == 0)
+    {
+      area->flags = SIGSEGV_WTRACK_USERFAULTFD;
+      return area;
+    }
+  if ((flags & SIGSEGV_WTRACK_SOFT_DIRTY) && soft_dirty_register (area) == 0)
+    {
+      area->flags = SIGSEGV_WTRACK_SOFT_DIRTY;
+      return area;
+    }
+
+  /* Track the writes through page protection.  */
+  area->flags = 0;
+  area->ticket = sigsegv_register (dispatcher, address, len,
+                                   wtrack_area_handler, area);
+  if (area->ticket == NULL)
+    goto fail2;
+  if (mprotect (address, len, PROT_READ) < 0)
+    goto fail3;
+  sigsegv_vma_snapshot_invalidate ();
+  return area;
+
+ fail3:
+  sigsegv_unregister (dispatcher, area->ticket);
+ fail2:
+  free (area->dirty);
+ fail1:
+  free (area);
+  return NULL;
+}
+
+int
+sigsegv_wtrack_get_flags (void *ticket)
+{
+  return ((struct wtrack_area *) ticket)->flags;
+}
+
+void
+sigsegv_wtrack_unregister (void *ticket)
+{
+  struct wtrack_area *area = (struct wtrack_area *) ticket;
+
+  if (area == NULL)
+    return;
+  if (area->flags & SIGSEGV_WTRACK_USERFAULTFD)
+    uffd_unregister (area);
+  else if (area->flags & SIGSEGV_WTRACK_SOFT_DIRTY)
+    soft_dirty_unregister (area);
+  else
+    {
+      mprotect ((void *) area->start, area->npages * pagesize,
+                PROT_READ | PROT_WRITE);
+      sigsegv_vma_snapshot_invalidate ();
+      sigsegv_unregister (area->dispatcher, area->ticket);
+    }
+  free (area->dirty);
+  free (area);
+}
+
+int
+sigsegv_wtrack_is_dirty (void *ticket, void *address)
+{
+  struct wtrack_area *area = (struct wtrack_area *) ticket;
+  uintptr_t offset = (uintptr_t) address - area->start;
+  size_t page = offset / pagesize;
+
+  if (offset >= area->npages * pagesize)
+    return -1;
+  if ((area->dirty[page / WORD_BITS] >> (page % WORD_BITS)) & 1)
+    return 1;
+  if (area->flags & SIGSEGV_WTRACK_SOFT_DIRTY)
+    return soft_dirty_bit (area, page);
+  return 0;
+}
+
+long
+sigsegv_wtrack_collect (void *ticket, sigsegv_wtrack_callback_t callback,
+                        void *user_arg)
+{
+  struct wtrack_area *area = (struct wtrack_area *) ticket;
+  size_t npages = area->npages;
+  size_t first = npages;
+  size_t last = 0;
+  long count = 0;
+  size_t i, j;
+
+  if (area->flags & SIGSEGV_WTRACK_SOFT_DIRTY)
+    {
+      if (soft_dirty_take (area) < 0)
+        return -1;
+      for (i = find_bit (area->collected, npages, 0, 1); i < npages;
+           i = find_bit (area->collected, npages, j, 1))
+        {
+          j = find_bit (area->collected, npages, i, 0);
+          count += j - i;
+        }
+    }
+  else
+    {
+      spin_lock (&area->lock);
+      take_dirty (area);
+      for (i = find_bit (area->collected, npages, 0, 1); i < npages;
+           i = find_bit (area->collected, npages, j, 1))
+        {
+          j = find_bit (area->collected, npages, i, 0);
+          if (i < first)
+            first = i;
+          last = j;
+          count += j - i;
+        }
+      /* The clean pages between the dirty ones are read-only already,
+         therefore a single mprotect() call makes all of them read-only.
+         Pages whose protection does not change don't cost much in it.
+         Likewise for the write protection of userfaultfd().  */
+      if (count > 0)
+        {
+          if ((area->flags & SIGSEGV_WTRACK_USERFAULTFD
+               ? uffd_write_protect (area->start + first * pagesize,
+                                     (last - first) * pagesize, 1)
+               : mprotect ((void *) (area->start + first * pagesize),
+                           (last - first) * pagesize, PROT_READ)) < 0)
+            {
+              /* The pages are still writable.  Keep them dirty.  */
+              size_t nwords = (npages + WORD_BITS - 1) / WORD_BITS;
+              size_t w;
+
+              for (w = 0; w < nwords; w++)
+                area->dirty[w] = area->collected[w];
+              spin_unlock (&area->lock);
+              return -1;
+            }
+          if (!(area->flags & SIGSEGV_WTRACK_USERFAULTFD))
+            sigsegv_vma_snapshot_invalidate ();
+        }
+      spin_unlock (&area->lock);
+    }
+
+  if (callback != NULL)
+    for (i = find_bit (area->collected, npages, 0, 1); i < npages;
+         i = find_bit (area->collected, npages, j, 1))
+      {
+        j = find_bit (area->collected, npages, i, 0);
+        (*callback) ((void *) (area->start + i * pagesize),
+                     (j - i) * pagesize, user_arg);
+      }
+  return count;
+}
+
+#endif
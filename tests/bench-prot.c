@@ -0,0 +1,201 @@
+/* Benchmark for the management of the protection of pages.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* Compares page-granular mprotect() calls, as a garbage collector issues
+   them, with the same changes made through the protection manager: the
+   number of mprotect() calls, the time, and the number of VMAs in the
+   area afterwards.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_CLOCK_GETTIME && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NPAGES 16384
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct range
+{
+  uintptr_t start;
+  uintptr_t end;
+  long count;
+};
+
+/* A callback for sigsegv_vma_iterate: counts the VMAs in a range.  */
+static int
+count_in_range (void *user_arg, const sigsegv_vma *vma)
+{
+  struct range *r = (struct range *) user_arg;
+
+  if ((uintptr_t) vma->start < r->end && (uintptr_t) vma->end > r->start)
+    r->count++;
+  return 0;
+}
+
+/* Returns the number of VMAs in [P, P+LEN), or -1 if not known.  */
+static long
+count_vmas (char *p, size_t len)
+{
+  struct range r;
+
+  r.start = (uintptr_t) p;
+  r.end = (uintptr_t) p + len;
+  r.count = 0;
+  if (sigsegv_vma_iterate (count_in_range, &r, NULL, 0) < 0)
+    return -1;
+  return r.count;
+}
+
+static int
+area_handler (void *fault_address, void *user_arg)
+{
+  return 0;
+}
+
+/* The phases of a collection cycle: which pages get which protection.
+   A phase consists of one or two passes over the pages.  */
+enum { PROTECT_ALL, UNPROTECT_SCATTERED, UNPROTECT_CLUSTERS, PROTECT_UNDONE,
+       NPHASES };
+static const char *phase_names[NPHASES] =
+  { "protect all", "unprotect 1/8", "unprotect runs", "protect, undo" };
+
+/* Returns the protection that the page I gets in pass PASS of PHASE, or -1
+   if it does not change.  */
+static int
+phase_prot (int phase, int pass, unsigned int i)
+{
+  switch (phase)
+    {
+    case PROTECT_ALL:
+      return (pass == 0 ? PROT_NONE : -1);
+    case UNPROTECT_SCATTERED:
+      return (pass == 0 && i % 8 == 0 ? PROT_READ_WRITE : -1);
+    case UNPROTECT_CLUSTERS:
+      return (pass == 0 && (i / 64) % 4 == 1 ? PROT_READ_WRITE : -1);
+    case PROTECT_UNDONE:
+      /* Pages that get protected and then unprotected again, before the
+         changes are flushed.  */
+      return ((i / 64) % 4 == 1 && i % 2 == 0
+              ? (pass == 0 ? PROT_NONE : PROT_READ_WRITE)
+              : -1);
+    default:
+      abort ();
+    }
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  size_t len = NPAGES * pagesize;
+  sigsegv_dispatcher dispatcher;
+  sigsegv_prot_stats stats;
+  char *direct;
+  char *managed;
+  void *ticket;
+  unsigned long calls_before;
+  int phase;
+
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+
+  direct = (char *) mmap_zeromap ((void *) 0, len);
+  managed = (char *) mmap_zeromap ((void *) 0, len);
+  if (direct == (char *) (-1) || managed == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      return 1;
+    }
+  sigsegv_init (&dispatcher);
+  ticket = sigsegv_prot_register (&dispatcher, managed, len, PROT_READ_WRITE,
+                                  area_handler, NULL);
+  if (ticket == NULL)
+    return 77;
+
+  printf ("%d pages\n", NPAGES);
+  printf ("%-16s %10s %10s %8s   %10s %10s %8s\n", "",
+          "mprotect", "us", "VMAs", "managed", "us", "VMAs");
+  for (phase = 0; phase < NPHASES; phase++)
+    {
+      unsigned int direct_calls = 0;
+      double t0, t1, t2;
+      unsigned int i;
+      int pass;
+
+      sigsegv_prot_get_stats (&stats);
+      calls_before = stats.mprotect_calls;
+      t0 = now ();
+      for (pass = 0; pass < 2; pass++)
+        for (i = 0; i < NPAGES; i++)
+          {
+            int prot = phase_prot (phase, pass, i);
+            if (prot >= 0)
+              {
+                mprotect (direct + i * pagesize, pagesize, prot);
+                direct_calls++;
+              }
+          }
+      t1 = now ();
+      for (pass = 0; pass < 2; pass++)
+        for (i = 0; i < NPAGES; i++)
+          {
+            int prot = phase_prot (phase, pass, i);
+            if (prot >= 0)
+              sigsegv_prot_set (ticket, managed + i * pagesize, pagesize,
+                                prot);
+          }
+      sigsegv_prot_flush (ticket);
+      t2 = now ();
+      sigsegv_prot_get_stats (&stats);
+      printf ("%-16s %10u %10.0f %8ld   %10lu %10.0f %8ld\n",
+              phase_names[phase],
+              direct_calls, (t1 - t0) * 1e6, count_vmas (direct, len),
+              stats.mprotect_calls - calls_before, (t2 - t1) * 1e6,
+              count_vmas (managed, len));
+    }
+  printf ("VMA headroom: %ld\n", stats.vma_headroom);
+
+  sigsegv_prot_unregister (ticket);
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
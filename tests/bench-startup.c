@@ -0,0 +1,167 @@
+/* Benchmark for the startup cost of the stack overflow handler.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* Measures the cost of stackoverflow_install_handler in a freshly started
+   process, depending on the number of memory mappings of the process.
+   For comparison, it also measures the cost of reading /proc/self/maps,
+   which is what stackoverflow_install_handler used to do.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_CLOCK_GETTIME && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define RUNS 100
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+}
+
+/* Returns the time it takes to read /proc/self/maps, or -1.  */
+static double
+read_maps (void)
+{
+  char buf[4096];
+  double t0 = now ();
+  int fd = open ("/proc/self/maps", O_RDONLY);
+
+  if (fd < 0)
+    return -1;
+  while (read (fd, buf, sizeof (buf)) > 0)
+    ;
+  close (fd);
+  return now () - t0;
+}
+
+/* Returns the average time of the first call to
+   stackoverflow_install_handler in a child process, or -1.  */
+static double
+install_in_child (void)
+{
+  double total = 0;
+  int run;
+
+  for (run = 0; run < RUNS; run++)
+    {
+      int fds[2];
+      pid_t pid;
+      double t;
+
+      if (pipe (fds) < 0)
+        return -1;
+      pid = fork ();
+      if (pid < 0)
+        return -1;
+      if (pid == 0)
+        {
+          double t0 = now ();
+          if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0)
+              < 0)
+            _exit (1);
+          t = now () - t0;
+          if (write (fds[1], &t, sizeof (t)) != sizeof (t))
+            _exit (1);
+          _exit (0);
+        }
+      close (fds[1]);
+      if (read (fds[0], &t, sizeof (t)) != sizeof (t))
+        t = -1;
+      close (fds[0]);
+      waitpid (pid, NULL, 0);
+      if (t < 0)
+        return -1;
+      total += t;
+    }
+  return total / RUNS;
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  unsigned int counts[] = { 0, 1000, 10000, 30000 };
+  unsigned int done = 0;
+  unsigned int c;
+
+  printf ("%10s %14s %14s\n", "mappings", "install (us)", "maps (us)");
+  for (c = 0; c < sizeof (counts) / sizeof (counts[0]); c++)
+    {
+      unsigned int n = counts[c];
+      double install_time, maps_time;
+
+      /* Add mappings, by changing the protection of every other page of a
+         region.  */
+      if (n > done)
+        {
+          char *p = (char *) mmap_zeromap ((void *) 0, 2 * (n - done) * pagesize);
+          unsigned int i;
+
+          if (p == (char *) (-1))
+            i = 0;
+          else
+            for (i = 0; i < n - done; i++)
+              if (mprotect (p + 2 * i * pagesize, pagesize, PROT_READ) < 0)
+                break;
+          if (i < n - done)
+            {
+              /* Probably the limit vm.max_map_count was hit.  */
+              fprintf (stderr, "cannot create %u mappings.\n", n);
+              break;
+            }
+          done = n;
+        }
+      install_time = install_in_child ();
+      maps_time = read_maps ();
+      if (install_time < 0 || maps_time < 0)
+        {
+          fprintf (stderr, "measurement failed.\n");
+          return 1;
+        }
+      printf ("%10u %14.1f %14.1f\n", n, install_time * 1e6, maps_time * 1e6);
+    }
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
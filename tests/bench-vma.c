@@ -0,0 +1,168 @@
+/* Benchmark for the lookup of the virtual memory area of an address.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* Measures the cost of determining the virtual memory area of the stack
+   with each of the backends of sigsegv_get_vma, depending on the number of
+   memory mappings of the process.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_STACKVMA && HAVE_CLOCK_GETTIME && (defined __linux__ || defined __ANDROID__)
+
+#include "mmap-anon-util.h"
+#include "stackvma.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOOKUPS 20
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Returns the number of memory mappings of the process.  */
+static unsigned int
+count_mappings (void)
+{
+  FILE *fp = fopen ("/proc/self/maps", "r");
+  unsigned int n = 0;
+  int c;
+
+  if (fp == NULL)
+    return 0;
+  while ((c = getc (fp)) != EOF)
+    if (c == '\n')
+      n++;
+  fclose (fp);
+  return n;
+}
+
+/* Prints the time of a lookup of ADDRESS with BACKEND, in microseconds.  */
+static void
+time_backend (int backend, uintptr_t address)
+{
+  struct vma_struct vma;
+  double t0, t1;
+  unsigned int i;
+
+  t0 = now ();
+  for (i = 0; i < LOOKUPS; i++)
+    if (sigsegv_get_vma_with (backend, address, &vma) != 0)
+      {
+        printf (" %12s", "-");
+        return;
+      }
+  t1 = now ();
+  printf (" %12.1f", (t1 - t0) * 1e6 / LOOKUPS);
+}
+
+/* Prints the time of a lookup of ADDRESS in the snapshot, once it has been
+   refreshed, in microseconds.  */
+static void
+time_snapshot (uintptr_t address)
+{
+  sigsegv_vma vma;
+  double t0, t1;
+  unsigned int i;
+
+  if (sigsegv_vma_snapshot_enable (1) < 0
+      || sigsegv_vma_query ((void *) address, &vma, NULL, 0) != 0)
+    {
+      printf (" %12s", "-");
+      return;
+    }
+  t0 = now ();
+  for (i = 0; i < LOOKUPS; i++)
+    sigsegv_vma_query ((void *) address, &vma, NULL, 0);
+  t1 = now ();
+  sigsegv_vma_snapshot_enable (0);
+  printf (" %12.1f", (t1 - t0) * 1e6 / LOOKUPS);
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  unsigned int counts[] = { 0, 100, 1000, 10000, 30000 };
+  unsigned int done = 0;
+  unsigned int c;
+  int dummy;
+
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+
+  printf ("%8s %12s %12s %12s %12s %12s %12s   (us per lookup)\n",
+          "mappings", "auto", "procmap", "proc", "iterate", "mincore",
+          "snapshot");
+  for (c = 0; c < sizeof (counts) / sizeof (counts[0]); c++)
+    {
+      unsigned int n = counts[c];
+
+      /* Add mappings, by changing the protection of every other page of a
+         region.  */
+      if (n > done)
+        {
+          char *p = (char *) mmap_zeromap ((void *) 0, 2 * (n - done) * pagesize);
+          unsigned int i;
+
+          if (p == (char *) (-1))
+            i = 0;
+          else
+            for (i = 0; i < n - done; i++)
+              if (mprotect (p + 2 * i * pagesize, pagesize, PROT_READ) < 0)
+                break;
+          if (i < n - done)
+            {
+              /* Probably the limit vm.max_map_count was hit.  */
+              fprintf (stderr, "cannot create %u mappings.\n", n);
+              break;
+            }
+          done = n;
+        }
+
+      printf ("%8u", count_mappings ());
+      time_backend (SV_VMA_BACKEND_AUTO, (uintptr_t) &dummy);
+      time_backend (SV_VMA_BACKEND_PROCMAP_QUERY, (uintptr_t) &dummy);
+      time_backend (SV_VMA_BACKEND_PROC, (uintptr_t) &dummy);
+      time_backend (SV_VMA_BACKEND_ITERATE, (uintptr_t) &dummy);
+      time_backend (SV_VMA_BACKEND_MINCORE, (uintptr_t) &dummy);
+      time_snapshot ((uintptr_t) &dummy);
+      printf ("\n");
+    }
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
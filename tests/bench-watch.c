@@ -0,0 +1,129 @@
+/* Benchmark for the data watchpoints.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* Measures the cost of setting watchpoints, and the cost of an access to a
+   watched page, inside and outside of the watched bytes.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && HAVE_CLOCK_GETTIME
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NPAGES 1024
+#define ACCESSES 100000
+
+static volatile unsigned long hits;
+
+static void
+watch_handler (void *fault_address, int is_write, void *user_arg)
+{
+  hits++;
+}
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  unsigned int counts[] = { 1, 16, 256, 4096 };
+  void *tickets[4096];
+  void *p;
+  uintptr_t area;
+  unsigned int c;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  p = mmap_zeromap ((void *) 0x12340000, NPAGES * pagesize);
+  if (p == (void *)(-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  area = (uintptr_t) p;
+
+  printf ("%10s %14s %14s %14s\n",
+          "watches", "set (us)", "miss (ns)", "hit (ns)");
+  for (c = 0; c < sizeof (counts) / sizeof (counts[0]); c++)
+    {
+      unsigned int n = counts[c];
+      double t0, t1, t2, t3;
+      unsigned int i;
+
+      /* Spread N 8-byte watchpoints over the pages, at offset 64.  */
+      t0 = now ();
+      for (i = 0; i < n; i++)
+        {
+          uintptr_t addr = area + (i % NPAGES) * pagesize + 64 + (i / NPAGES) * 16;
+          tickets[i] = sigsegv_watch ((void *) addr, 8, 0, &watch_handler, NULL);
+          if (tickets[i] == NULL)
+            {
+              fprintf (stderr, "sigsegv_watch failed.\n");
+              return 77;
+            }
+        }
+      t1 = now ();
+      /* Accesses to unwatched bytes of watched pages.  */
+      for (i = 0; i < ACCESSES; i++)
+        *(volatile int *) (area + (i % n % NPAGES) * pagesize + 2048) = i;
+      t2 = now ();
+      /* Accesses to watched bytes.  */
+      for (i = 0; i < ACCESSES; i++)
+        *(volatile int *) (area + (i % n % NPAGES) * pagesize + 64) = i;
+      t3 = now ();
+      for (i = 0; i < n; i++)
+        sigsegv_unwatch (tickets[i]);
+
+      printf ("%10u %14.1f %14.1f %14.1f\n", n,
+              (t1 - t0) * 1e6 / n,
+              (t2 - t1) * 1e9 / ACCESSES,
+              (t3 - t2) * 1e9 / ACCESSES);
+    }
+  if (hits != (unsigned long) ACCESSES * (sizeof (counts) / sizeof (counts[0])))
+    {
+      fprintf (stderr, "wrong number of hits: %lu\n", hits);
+      return 1;
+    }
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
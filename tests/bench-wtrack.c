@@ -0,0 +1,245 @@
+/* Benchmark for the tracking of the pages that are written to.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+/* Compares the write barrier that garbage collectors commonly build on
+   sigsegv_register - a byte per page, set by the area handler, and one
+   mprotect() call per dirty page to protect it again - with
+   sigsegv_wtrack_register and sigsegv_wtrack_collect, with page protection,
+   with soft-dirty bits and with userfaultfd().  Measures the time of the
+   writes, which includes the faults, and of the collection.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && HAVE_CLOCK_GETTIME && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NPAGES 16384
+#define CYCLES 4
+
+static size_t pagesize;
+static sigsegv_dispatcher dispatcher;
+
+static double
+now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The hand-rolled card table.  */
+static char *cards_area;
+static unsigned char cards[NPAGES];
+
+static int
+card_handler (void *fault_address, void *user_arg)
+{
+  size_t page = ((char *) fault_address - cards_area) / pagesize;
+
+  cards[page] = 1;
+  return mprotect (cards_area + page * pagesize, pagesize,
+                   PROT_READ_WRITE) == 0;
+}
+
+static long
+cards_collect (void)
+{
+  long count = 0;
+  unsigned int i;
+
+  for (i = 0; i < NPAGES; i++)
+    if (cards[i])
+      {
+        cards[i] = 0;
+        mprotect (cards_area + i * pagesize, pagesize, PROT_READ);
+        count++;
+      }
+  return count;
+}
+
+static int
+handler (void *fault_address, int serious)
+{
+  return sigsegv_dispatch (&dispatcher, fault_address);
+}
+
+/* The write patterns of the mutator between two collections.  */
+enum { SCATTERED, CLUSTERS, ALL, NPATTERNS };
+static const char *pattern_names[NPATTERNS] =
+  { "1/16 of pages", "runs of 32", "all pages" };
+
+static int
+is_written (int pattern, unsigned int i)
+{
+  switch (pattern)
+    {
+    case SCATTERED:
+      return i % 16 == 5;
+    case CLUSTERS:
+      return (i / 32) % 8 == 3;
+    case ALL:
+      return 1;
+    default:
+      abort ();
+    }
+}
+
+/* Writes to the pages of P according to PATTERN.  Returns the time it took,
+   in microseconds.  */
+static double
+mutate (volatile char *p, int pattern)
+{
+  double t0 = now ();
+  unsigned int i;
+
+  for (i = 0; i < NPAGES; i++)
+    if (is_written (pattern, i))
+      p[i * pagesize]++;
+  return (now () - t0) * 1e6;
+}
+
+/* The methods of sigsegv_wtrack_register_flags.  */
+#define NMETHODS 3
+static const int method_flags[NMETHODS] =
+  { 0, SIGSEGV_WTRACK_SOFT_DIRTY, SIGSEGV_WTRACK_USERFAULTFD };
+static const char *method_names[NMETHODS] =
+  { "wtrack wr.", "soft wr.", "uffd wr." };
+
+int
+main ()
+{
+  size_t len;
+  char *tracked[NMETHODS];
+  void *tickets[NMETHODS];
+  int pattern;
+  int m;
+
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  pagesize = getpagesize ();
+  len = NPAGES * pagesize;
+  sigsegv_init (&dispatcher);
+  if (sigsegv_install_handler (&handler) < 0)
+    return 77;
+
+  cards_area = (char *) mmap_zeromap ((void *) 0, len);
+  if (cards_area == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      return 1;
+    }
+  if (mprotect (cards_area, len, PROT_READ) < 0
+      || sigsegv_register (&dispatcher, cards_area, len, card_handler, NULL)
+         == NULL)
+    return 1;
+  for (m = 0; m < NMETHODS; m++)
+    {
+      tracked[m] = (char *) mmap_zeromap ((void *) 0, len);
+      if (tracked[m] == (char *) (-1))
+        {
+          fprintf (stderr, "mmap_zeromap failed.\n");
+          return 1;
+        }
+      tickets[m] = sigsegv_wtrack_register_flags (&dispatcher, tracked[m], len,
+                                                  method_flags[m]);
+      if (tickets[m] == NULL)
+        return 77;
+      if (sigsegv_wtrack_get_flags (tickets[m]) != method_flags[m])
+        {
+          /* The method is not available.  */
+          sigsegv_wtrack_unregister (tickets[m]);
+          tickets[m] = NULL;
+        }
+    }
+
+  printf ("%d pages, us per cycle\n", NPAGES);
+  printf ("%-14s %6s   %10s %10s", "", "dirty", "writes", "collect");
+  for (m = 0; m < NMETHODS; m++)
+    printf ("   %10s %10s", method_names[m], "collect");
+  printf ("\n");
+  for (pattern = 0; pattern < NPATTERNS; pattern++)
+    {
+      double cards_write = 0, cards_time = 0;
+      double write_time[NMETHODS], collect_time[NMETHODS];
+      long dirty = 0;
+      int cycle;
+
+      for (m = 0; m < NMETHODS; m++)
+        write_time[m] = collect_time[m] = 0;
+      for (cycle = 0; cycle < CYCLES; cycle++)
+        {
+          double t0;
+
+          cards_write += mutate (cards_area, pattern);
+          t0 = now ();
+          dirty = cards_collect ();
+          cards_time += (now () - t0) * 1e6;
+
+          for (m = 0; m < NMETHODS; m++)
+            if (tickets[m] != NULL)
+              {
+                long count;
+
+                write_time[m] += mutate (tracked[m], pattern);
+                t0 = now ();
+                count = sigsegv_wtrack_collect (tickets[m], NULL, NULL);
+                collect_time[m] += (now () - t0) * 1e6;
+                /* Soft-dirty bits may report more pages, never fewer.  */
+                if (method_flags[m] == SIGSEGV_WTRACK_SOFT_DIRTY
+                    ? count < dirty : count != dirty)
+                  {
+                    fprintf (stderr, "wrong number of dirty pages.\n");
+                    return 1;
+                  }
+              }
+        }
+      printf ("%-14s %6ld   %10.0f %10.0f",
+              pattern_names[pattern], dirty,
+              cards_write / CYCLES, cards_time / CYCLES);
+      for (m = 0; m < NMETHODS; m++)
+        if (tickets[m] != NULL)
+          printf ("   %10.0f %10.0f",
+                  write_time[m] / CYCLES, collect_time[m] / CYCLES);
+        else
+          printf ("   %10s %10s", "-", "-");
+      printf ("\n");
+    }
+
+  for (m = 0; m < NMETHODS; m++)
+    sigsegv_wtrack_unregister (tickets[m]);
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
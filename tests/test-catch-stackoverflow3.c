@@ -0,0 +1,180 @@
+/* Test the stack overflow handler on many threads at once.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* Skip this test when an address sanitizer is in use.  */
+#ifndef __has_feature
+# define __has_feature(a) 0
+#endif
+#if defined __SANITIZE_ADDRESS__ || __has_feature (address_sanitizer)
+# undef HAVE_STACK_OVERFLOW_RECOVERY
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_PTHREAD && HAVE_THREAD_LOCAL
+
+#include <stdlib.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include "altstack-util.h"
+
+#define NTHREADS 256
+#define THREAD_STACK_SIZE 0x40000 /* 256 KB */
+#define EXTRA_STACK_SIZE 0x10000  /* 64 KB */
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The state of each thread.  */
+static SV_THREAD_LOCAL jmp_buf thread_loop;
+static SV_THREAD_LOCAL sigset_t thread_sigset;
+static SV_THREAD_LOCAL char *thread_extra_stack;
+
+/* The outcome of each thread: 1 if its stack overflow was caught.  */
+static volatile int caught[NTHREADS];
+
+static void
+stackoverflow_handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  int arg = (int) (long) arg1;
+  longjmp (thread_loop, arg);
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+  char dummy;
+  char *addr = &dummy;
+  /* The handler must run on the alternate stack of this thread.  */
+  if (!(addr >= thread_extra_stack
+        && addr <= thread_extra_stack + EXTRA_STACK_SIZE - 1))
+    abort ();
+  pthread_sigmask (SIG_SETMASK, &thread_sigset, NULL);
+  sigsegv_leave_handler (stackoverflow_handler_continuation,
+                         (void *) (long) (emergency ? -1 : 1), NULL, NULL);
+}
+
+static volatile int *
+recurse_1 (int n, volatile int *p)
+{
+  if (n < INT_MAX)
+    *recurse_1 (n + 1, p) += n;
+  return p;
+}
+
+static int
+recurse (volatile int n)
+{
+  return *recurse_1 (n, &n);
+}
+
+static void *
+overflower (void *arg)
+{
+  int i = (int) (long) arg;
+  sigset_t emptyset;
+
+  thread_extra_stack = (char *) malloc (EXTRA_STACK_SIZE);
+  if (thread_extra_stack == NULL)
+    exit (2);
+  if (stackoverflow_register_thread (thread_extra_stack, EXTRA_STACK_SIZE)
+      < 0)
+    /* Not supported on this platform.  */
+    exit (77);
+
+  sigemptyset (&emptyset);
+  pthread_sigmask (SIG_BLOCK, &emptyset, &thread_sigset);
+
+  /* Wait until all threads are ready.  */
+  pthread_mutex_lock (&start_lock);
+  pthread_mutex_unlock (&start_lock);
+
+  switch (setjmp (thread_loop))
+    {
+    case 0:
+      recurse (0);
+      printf ("no endless recursion?!\n"); exit (1);
+    case 1:
+      caught[i] = 1;
+      break;
+    default:
+      printf ("emergency exit\n"); exit (1);
+    }
+
+  stackoverflow_unregister_thread ();
+  free (thread_extra_stack);
+  return NULL;
+}
+
+int
+main ()
+{
+  pthread_t threads[NTHREADS];
+  pthread_attr_t attr;
+  int i;
+
+  /* Prepare the storage for the alternate stack of the main thread.  */
+  prepare_alternate_stack ();
+
+  /* Install the stack overflow handler.  */
+  if (stackoverflow_install_handler (&stackoverflow_handler,
+                                     mystack, SIGSTKSZ)
+      < 0)
+    exit (2);
+
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr, THREAD_STACK_SIZE);
+
+  /* Let all threads overflow their stacks at the same time.  */
+  pthread_mutex_lock (&start_lock);
+  for (i = 0; i < NTHREADS; i++)
+    if (pthread_create (&threads[i], &attr, overflower, (void *) (long) i)
+        != 0)
+      exit (2);
+  pthread_mutex_unlock (&start_lock);
+  for (i = 0; i < NTHREADS; i++)
+    pthread_join (threads[i], NULL);
+  pthread_attr_destroy (&attr);
+
+  for (i = 0; i < NTHREADS; i++)
+    if (!caught[i])
+      {
+        printf ("Stack overflow on thread %d not caught.\n", i);
+        exit (1);
+      }
+
+  /* Validate that the alternate stack did not overflow.  */
+  check_alternate_stack_no_overflow ();
+
+  printf ("Test passed.\n");
+  exit (0);
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
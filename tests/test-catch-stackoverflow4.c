@@ -0,0 +1,223 @@
+/* Test the stack overflow handler with alternate stacks from libsigsegv.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* Skip this test when an address sanitizer is in use.  */
+#ifndef __has_feature
+# define __has_feature(a) 0
+#endif
+#if defined __SANITIZE_ADDRESS__ || __has_feature (address_sanitizer)
+# undef HAVE_STACK_OVERFLOW_RECOVERY
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_PTHREAD && HAVE_THREAD_LOCAL
+
+#include <stdlib.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <unistd.h>
+#if HAVE_SETRLIMIT
+# include <sys/types.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+
+#define NTHREADS 32
+#define THREAD_STACK_SIZE 0x40000 /* 256 KB */
+
+static SV_THREAD_LOCAL jmp_buf loop;
+static SV_THREAD_LOCAL sigset_t saved_sigset;
+
+/* The alternate stack of each thread, in each of two rounds.  */
+static void *extra_stacks[2][NTHREADS];
+
+/* The number of threads that got their alternate stack.  */
+static volatile int started;
+static pthread_mutex_t started_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+stackoverflow_handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  int arg = (int) (long) arg1;
+  longjmp (loop, arg);
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+  pthread_sigmask (SIG_SETMASK, &saved_sigset, NULL);
+  sigsegv_leave_handler (stackoverflow_handler_continuation,
+                         (void *) (long) (emergency ? -1 : 1), NULL, NULL);
+}
+
+static volatile int *
+recurse_1 (int n, volatile int *p)
+{
+  if (n < INT_MAX)
+    *recurse_1 (n + 1, p) += n;
+  return p;
+}
+
+static int
+recurse (volatile int n)
+{
+  return *recurse_1 (n, &n);
+}
+
+/* Overflows the stack of the current thread.  Returns 1 if the handler was
+   called, 0 otherwise.  */
+static int
+overflow (void)
+{
+  sigset_t emptyset;
+
+  sigemptyset (&emptyset);
+  pthread_sigmask (SIG_BLOCK, &emptyset, &saved_sigset);
+  switch (setjmp (loop))
+    {
+    case 0:
+      recurse (0);
+      return 0;
+    case 1:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/* Returns the alternate stack of the current thread, or NULL.  */
+static void *
+current_extra_stack (void)
+{
+  stack_t ss;
+
+  if (sigaltstack (NULL, &ss) < 0 || (ss.ss_flags & SS_DISABLE))
+    return NULL;
+  return ss.ss_sp;
+}
+
+static void *
+overflower (void *arg)
+{
+  int i = (int) (long) arg;
+
+  if (stackoverflow_register_thread (NULL, 0) < 0)
+    /* Not supported on this platform.  */
+    exit (77);
+  extra_stacks[i / NTHREADS][i % NTHREADS] = current_extra_stack ();
+  if (extra_stacks[i / NTHREADS][i % NTHREADS] == NULL)
+    exit (1);
+  /* Wait until all threads of this round have their alternate stack, so
+     that no thread reuses the alternate stack of a thread of the same
+     round.  */
+  pthread_mutex_lock (&started_lock);
+  started++;
+  pthread_mutex_unlock (&started_lock);
+  while (started < (i / NTHREADS + 1) * NTHREADS)
+    usleep (1000);
+  if (!overflow ())
+    {
+      printf ("Stack overflow on thread %d not caught.\n", i);
+      exit (1);
+    }
+  /* The alternate stack goes back to the pool when the thread exits.  */
+#if !HAVE_PTHREAD_KEY_CREATE
+  stackoverflow_unregister_thread ();
+#endif
+  return NULL;
+}
+
+int
+main ()
+{
+  pthread_t threads[NTHREADS];
+  pthread_attr_t attr;
+  int round;
+  int i;
+  int j;
+
+#if HAVE_SETRLIMIT && defined RLIMIT_STACK
+  /* Before starting the endless recursion, try to be friendly to the user's
+     machine.  On some Linux 2.2.x systems, there is no stack limit for user
+     processes at all.  We don't want to kill such systems.  */
+  struct rlimit rl;
+  rl.rlim_cur = rl.rlim_max = 0x100000; /* 1 MB */
+  setrlimit (RLIMIT_STACK, &rl);
+#endif
+
+  /* Install the stack overflow handler, without an alternate stack of our
+     own.  */
+  if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0) < 0)
+    exit (2);
+  if (current_extra_stack () == NULL)
+    exit (1);
+  if (!overflow ())
+    {
+      printf ("Stack overflow on the main thread not caught.\n");
+      exit (1);
+    }
+
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr, THREAD_STACK_SIZE);
+  for (round = 0; round < 2; round++)
+    {
+      for (i = 0; i < NTHREADS; i++)
+        if (pthread_create (&threads[i], &attr, overflower,
+                            (void *) (long) (round * NTHREADS + i))
+            != 0)
+          exit (2);
+      for (i = 0; i < NTHREADS; i++)
+        pthread_join (threads[i], NULL);
+    }
+  pthread_attr_destroy (&attr);
+
+  /* The threads of the second round reused the alternate stacks of the
+     threads of the first round.  */
+  for (i = 0; i < NTHREADS; i++)
+    {
+      for (j = 0; j < NTHREADS; j++)
+        if (extra_stacks[1][i] == extra_stacks[0][j])
+          break;
+      if (j == NTHREADS)
+        {
+          printf ("Alternate stack was not recycled.\n");
+          exit (1);
+        }
+    }
+
+  stackoverflow_deinstall_handler ();
+
+  printf ("Test passed.\n");
+  exit (0);
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/* Test the emulation of faulting memory accesses.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && defined __linux__ && defined __x86_64__
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+
+static sigsegv_dispatcher dispatcher;
+
+static uintptr_t area;
+static uintptr_t shadow;
+
+static volatile int handler_called = 0;
+static volatile long long s8, s16;
+
+static int
+area_handler (void *fault_address, void *user_arg)
+{
+  sigsegv_access access;
+
+  handler_called++;
+  if (sigsegv_decode_access (&access) < 0)
+    abort ();
+  if ((uintptr_t) access.address != (uintptr_t) fault_address)
+    abort ();
+  if (!((uintptr_t) access.address >= area
+        && (uintptr_t) access.address + access.size <= area + 0x4000))
+    abort ();
+  sigsegv_emulate_access (&access,
+                          (void *) (shadow + ((uintptr_t) access.address - area)));
+  return 1;
+}
+
+static int
+handler (void *fault_address, int serious)
+{
+  return sigsegv_dispatch (&dispatcher, fault_address);
+}
+
+int
+main ()
+{
+  void *p;
+  volatile unsigned char *a8;
+  volatile unsigned short *a16;
+  volatile unsigned int *a32;
+  volatile unsigned long long *a64;
+  unsigned long long u64;
+  int expected_calls;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  sigsegv_init (&dispatcher);
+  sigsegv_install_handler (&handler);
+
+  /* Setup the protected area and its shadow.  */
+  p = mmap_zeromap ((void *) 0x12340000, 0x4000);
+  if (p == (void *)(-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  area = (uintptr_t) p;
+  p = mmap_zeromap ((void *) 0x0BEE0000, 0x4000);
+  if (p == (void *)(-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  shadow = (uintptr_t) p;
+  if (mprotect ((void *) area, 0x4000, PROT_NONE) < 0)
+    {
+      fprintf (stderr, "mprotect failed.\n");
+      exit (2);
+    }
+  sigsegv_register (&dispatcher, (void *) area, 0x4000, &area_handler, NULL);
+
+  a8 = (volatile unsigned char *) (area + 0x123);
+  a16 = (volatile unsigned short *) (area + 0x1234);
+  a32 = (volatile unsigned int *) (area + 0x2344);
+  a64 = (volatile unsigned long long *) (area + 0x3458);
+
+  /* Stores of registers and of immediates.  */
+  *a8 = 0xA5;
+  *a16 = 0x8765;
+  *a32 = 0x89ABCDEFU;
+  *a64 = 0xFEDCBA9876543210ULL;
+  expected_calls = 4;
+  if (handler_called != expected_calls)
+    exit (1);
+  if (*(unsigned char *) (shadow + 0x123) != 0xA5
+      || *(unsigned short *) (shadow + 0x1234) != 0x8765
+      || *(unsigned int *) (shadow + 0x2344) != 0x89ABCDEFU
+      || *(unsigned long long *) (shadow + 0x3458) != 0xFEDCBA9876543210ULL)
+    exit (1);
+
+  /* Loads, with zero and sign extension.  */
+  if (*a8 != 0xA5)
+    exit (1);
+  s8 = *(volatile signed char *) a8;
+  s16 = *(volatile short *) a16;
+  if (s8 != -0x5B || s16 != -0x789B)
+    exit (1);
+  if (*a16 != 0x8765 || *a32 != 0x89ABCDEFU)
+    exit (1);
+  u64 = *a64;
+  if (u64 != 0xFEDCBA9876543210ULL)
+    exit (1);
+  expected_calls += 6;
+  if (handler_called != expected_calls)
+    exit (1);
+
+  /* The area stayed protected all the time.  */
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,214 @@
+/* Test the stack overflow handler on registered fiber stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* Skip this test when an address sanitizer is in use.  */
+#ifndef __has_feature
+# define __has_feature(a) 0
+#endif
+#if defined __SANITIZE_ADDRESS__ || __has_feature (address_sanitizer)
+# undef HAVE_STACK_OVERFLOW_RECOVERY
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_MAKECONTEXT && STACK_DIRECTION < 0
+
+#include <stdlib.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <ucontext.h>
+#if HAVE_SETRLIMIT
+# include <sys/types.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+#include "mmap-anon-util.h"
+
+#define NFIBERS 4
+#define GUARD_SIZE 0x10000
+#define FIBER_STACK_SIZE 0x40000
+
+static jmp_buf mainloop;
+static sigset_t mainsigset;
+static ucontext_t main_context;
+static ucontext_t fiber_context;
+
+/* The ticket of the stack of each fiber.  */
+static void *tickets[NFIBERS];
+
+/* The fiber whose stack is expected to overflow.  */
+static volatile int current_fiber;
+
+static void
+stackoverflow_handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  int arg = (int) (long) arg1;
+  longjmp (mainloop, arg);
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+  void *ticket = stackoverflow_overflowed_stack ();
+  int result;
+
+  if (emergency)
+    result = -1;
+  else if (current_fiber < 0)
+    result = (ticket == NULL ? 1 : -2);
+  else
+    result = (ticket == tickets[current_fiber] ? 1 : -2);
+  sigprocmask (SIG_SETMASK, &mainsigset, NULL);
+  sigsegv_leave_handler (stackoverflow_handler_continuation,
+                         (void *) (long) result, NULL, NULL);
+}
+
+static volatile int *
+recurse_1 (int n, volatile int *p)
+{
+  if (n < INT_MAX)
+    *recurse_1 (n + 1, p) += n;
+  return p;
+}
+
+static int
+recurse (volatile int n)
+{
+  return *recurse_1 (n, &n);
+}
+
+static void
+fiber (void)
+{
+  recurse (0);
+}
+
+int
+main ()
+{
+  char *stacks[NFIBERS];
+  sigset_t emptyset;
+  int i;
+
+#if HAVE_SETRLIMIT && defined RLIMIT_STACK
+  /* Before starting the endless recursion, try to be friendly to the user's
+     machine.  */
+  struct rlimit rl;
+  rl.rlim_cur = rl.rlim_max = 0x100000; /* 1 MB */
+  setrlimit (RLIMIT_STACK, &rl);
+#endif
+
+  /* Install the stack overflow handler.  */
+  if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0) < 0)
+    exit (2);
+
+  /* Allocate the fiber stacks, each with a guard area below it.  */
+  for (i = 0; i < NFIBERS; i++)
+    {
+      char *p = (char *) mmap_zeromap ((void *) 0, GUARD_SIZE + FIBER_STACK_SIZE);
+      if (p == (char *) (-1))
+        {
+          fprintf (stderr, "mmap_zeromap failed.\n");
+          exit (2);
+        }
+      if (mprotect (p, GUARD_SIZE, PROT_NONE) < 0)
+        {
+          fprintf (stderr, "mprotect failed.\n");
+          exit (2);
+        }
+      stacks[i] = p + GUARD_SIZE;
+      tickets[i] = sigsegv_register_stack (stacks[i],
+                                           stacks[i] + FIBER_STACK_SIZE,
+                                           GUARD_SIZE);
+      if (tickets[i] == NULL)
+        exit (77);
+    }
+
+  /* A guard area that would wrap around the address space is rejected.  */
+  if (sigsegv_register_stack ((void *) GUARD_SIZE,
+                              (void *) (GUARD_SIZE + FIBER_STACK_SIZE),
+                              2 * GUARD_SIZE)
+      != NULL)
+    {
+      printf ("guard area below address 0 accepted\n");
+      exit (1);
+    }
+
+  /* Save the current signal mask.  */
+  sigemptyset (&emptyset);
+  sigprocmask (SIG_BLOCK, &emptyset, &mainsigset);
+
+  /* Let each fiber overflow its stack, in reverse order.  */
+  for (i = NFIBERS - 1; i >= 0; i--)
+    {
+      current_fiber = i;
+      switch (setjmp (mainloop))
+        {
+        case 0:
+          if (getcontext (&fiber_context) < 0)
+            exit (2);
+          fiber_context.uc_stack.ss_sp = stacks[i];
+          fiber_context.uc_stack.ss_size = FIBER_STACK_SIZE;
+          fiber_context.uc_link = &main_context;
+          makecontext (&fiber_context, fiber, 0);
+          swapcontext (&main_context, &fiber_context);
+          printf ("no endless recursion?!\n"); exit (1);
+        case 1:
+          break;
+        case -1:
+          printf ("emergency exit\n"); exit (1);
+        default:
+          printf ("Stack overflow of fiber %d attributed to the wrong stack.\n", i);
+          exit (1);
+        }
+    }
+
+  for (i = 0; i < NFIBERS; i++)
+    sigsegv_unregister_stack (tickets[i]);
+
+  /* An overflow of the thread's own stack is not attributed to a fiber.  */
+  current_fiber = -1;
+  switch (setjmp (mainloop))
+    {
+    case 0:
+      recurse (0);
+      printf ("no endless recursion?!\n"); exit (1);
+    case 1:
+      break;
+    default:
+      printf ("Stack overflow of the main stack attributed to a fiber.\n");
+      exit (1);
+    }
+
+  printf ("Test passed.\n");
+  exit (0);
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
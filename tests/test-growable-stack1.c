@@ -0,0 +1,209 @@
+/* Test growable stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* Skip this test when an address sanitizer is in use.  */
+#ifndef __has_feature
+# define __has_feature(a) 0
+#endif
+#if defined __SANITIZE_ADDRESS__ || __has_feature (address_sanitizer)
+# undef HAVE_STACK_OVERFLOW_RECOVERY
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_SIGSEGV_RECOVERY && HAVE_MAKECONTEXT && STACK_DIRECTION < 0
+
+#include <stdlib.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <ucontext.h>
+#if HAVE_SETRLIMIT
+# include <sys/types.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+#include "mmap-anon-util.h"
+
+#define RESERVED_SIZE 0x100000
+#define INITIAL_SIZE 0x2000
+#define CHUNK_SIZE 0x4000
+
+static jmp_buf mainloop;
+static sigset_t mainsigset;
+static ucontext_t main_context;
+static ucontext_t fiber_context;
+
+static void *ticket;
+
+/* The recursion depth of the fiber, or 0 for an endless recursion.  */
+static volatile int depth;
+
+static void
+stackoverflow_handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  int arg = (int) (long) arg1;
+  longjmp (mainloop, arg);
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+  int result;
+
+  if (emergency)
+    result = -1;
+  else
+    result = (stackoverflow_overflowed_stack () == ticket ? 1 : -2);
+  sigprocmask (SIG_SETMASK, &mainsigset, NULL);
+  sigsegv_leave_handler (stackoverflow_handler_continuation,
+                         (void *) (long) result, NULL, NULL);
+}
+
+static volatile int *
+recurse_1 (int n, volatile int *p)
+{
+  if (n < (depth > 0 ? depth : INT_MAX))
+    *recurse_1 (n + 1, p) += n;
+  return p;
+}
+
+static int
+recurse (volatile int n)
+{
+  return *recurse_1 (n, &n);
+}
+
+static void
+fiber (void)
+{
+  recurse (0);
+}
+
+static void
+run_fiber (char *stack)
+{
+  if (getcontext (&fiber_context) < 0)
+    exit (2);
+  fiber_context.uc_stack.ss_sp = stack;
+  fiber_context.uc_stack.ss_size = RESERVED_SIZE;
+  fiber_context.uc_link = &main_context;
+  makecontext (&fiber_context, fiber, 0);
+  swapcontext (&main_context, &fiber_context);
+}
+
+int
+main ()
+{
+  char *stack;
+  sigset_t emptyset;
+  size_t size;
+
+#if HAVE_SETRLIMIT && defined RLIMIT_STACK
+  /* Before starting the endless recursion, try to be friendly to the user's
+     machine.  */
+  struct rlimit rl;
+  rl.rlim_cur = rl.rlim_max = 0x100000; /* 1 MB */
+  setrlimit (RLIMIT_STACK, &rl);
+#endif
+
+  /* Install the stack overflow handler.  */
+  if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0) < 0)
+    exit (2);
+
+  /* Reserve the stack.  */
+  stack = (char *) mmap_zeromap ((void *) 0, RESERVED_SIZE);
+  if (stack == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  if (mprotect (stack, RESERVED_SIZE, PROT_NONE) < 0)
+    {
+      fprintf (stderr, "mprotect failed.\n");
+      exit (2);
+    }
+  ticket = sigsegv_register_growable_stack (stack, RESERVED_SIZE,
+                                            INITIAL_SIZE, CHUNK_SIZE);
+  if (ticket == NULL)
+    exit (77);
+  if (sigsegv_stack_size (ticket) != INITIAL_SIZE)
+    exit (1);
+
+  /* Save the current signal mask.  */
+  sigemptyset (&emptyset);
+  sigprocmask (SIG_BLOCK, &emptyset, &mainsigset);
+
+  /* A bounded recursion grows the stack without overflowing it.  */
+  depth = 1000;
+  switch (setjmp (mainloop))
+    {
+    case 0:
+      run_fiber (stack);
+      break;
+    default:
+      printf ("bounded recursion overflowed\n"); exit (1);
+    }
+  size = sigsegv_stack_size (ticket);
+  if (!(size > INITIAL_SIZE && size < RESERVED_SIZE / 2))
+    {
+      printf ("unexpected stack size %lu\n", (unsigned long) size);
+      exit (1);
+    }
+
+  /* An endless recursion grows the stack up to its limit, and only then
+     overflows it.  */
+  depth = 0;
+  switch (setjmp (mainloop))
+    {
+    case 0:
+      run_fiber (stack);
+      printf ("no endless recursion?!\n"); exit (1);
+    case 1:
+      break;
+    case -1:
+      printf ("emergency exit\n"); exit (1);
+    default:
+      printf ("Stack overflow attributed to the wrong stack.\n");
+      exit (1);
+    }
+  size = sigsegv_stack_size (ticket);
+  if (!(size > RESERVED_SIZE / 2 && size < RESERVED_SIZE))
+    {
+      printf ("unexpected stack size %lu\n", (unsigned long) size);
+      exit (1);
+    }
+
+  sigsegv_unregister_stack (ticket);
+
+  printf ("Test passed.\n");
+  exit (0);
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/* Test the management of the protection of pages.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NPAGES 16
+
+static sigsegv_dispatcher dispatcher;
+static void *ticket;
+static size_t pagesize;
+static volatile unsigned int handler_calls;
+
+/* Makes the page that faulted accessible again.  */
+static int
+area_handler (void *fault_address, void *user_arg)
+{
+  handler_calls++;
+  if (sigsegv_prot_get (ticket, fault_address) != PROT_NONE)
+    abort ();
+  if (sigsegv_prot_set (ticket,
+                        (void *) ((uintptr_t) fault_address & -pagesize),
+                        pagesize, PROT_READ_WRITE) < 0)
+    abort ();
+  return sigsegv_prot_flush (ticket) == 1;
+}
+
+static int
+handler (void *fault_address, int serious)
+{
+  return sigsegv_dispatch (&dispatcher, fault_address);
+}
+
+int
+main ()
+{
+  sigsegv_prot_stats stats;
+  volatile char *p;
+  int i;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  pagesize = getpagesize ();
+  sigsegv_init (&dispatcher);
+  if (sigsegv_install_handler (&handler) < 0)
+    return 77;
+
+  p = (volatile char *) mmap_zeromap ((void *) 0, NPAGES * pagesize);
+  if (p == (volatile char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  ticket = sigsegv_prot_register (&dispatcher, (void *) p, NPAGES * pagesize,
+                                  PROT_READ_WRITE, area_handler, NULL);
+  if (ticket == NULL)
+    return 77;
+
+  /* Changes are recorded, but not applied before the flush.  */
+  for (i = 2; i < 10; i += 2)
+    if (sigsegv_prot_set (ticket, (void *) (p + i * pagesize), pagesize,
+                          PROT_NONE) < 0)
+      exit (1);
+  for (i = 3; i < 10; i += 2)
+    if (sigsegv_prot_set (ticket, (void *) (p + i * pagesize), pagesize,
+                          PROT_NONE) < 0)
+      exit (1);
+  if (sigsegv_prot_get (ticket, (void *) (p + 5 * pagesize)) != PROT_NONE)
+    exit (1);
+  p[5 * pagesize] = 1;
+  if (handler_calls != 0)
+    exit (1);
+  /* The pages 2..9 are protected with a single call.  */
+  if (sigsegv_prot_flush (ticket) != 1)
+    exit (1);
+  if (sigsegv_prot_flush (NULL) != 0)
+    exit (1);
+  sigsegv_prot_get_stats (&stats);
+  if (stats.runs != 3)
+    exit (1);
+
+  /* A fault in a protected page goes to the handler.  */
+  p[5 * pagesize] = 2;
+  if (handler_calls != 1 || p[5 * pagesize] != 2)
+    exit (1);
+
+  /* A fault in a page whose unprotection is pending applies it, without
+     calling the handler.  */
+  if (sigsegv_prot_set (ticket, (void *) (p + 7 * pagesize), pagesize,
+                        PROT_READ_WRITE) < 0)
+    exit (1);
+  p[7 * pagesize] = 3;
+  if (handler_calls != 1 || p[7 * pagesize] != 3)
+    exit (1);
+
+  /* Intervals outside the area are rejected.  */
+  if (sigsegv_prot_set (ticket, (void *) (p + 15 * pagesize), 2 * pagesize,
+                        PROT_NONE) != -1)
+    exit (1);
+  if (sigsegv_prot_get (ticket, (void *) (p + NPAGES * pagesize)) != -1)
+    exit (1);
+
+  sigsegv_prot_get_stats (&stats);
+  if (stats.mprotect_calls != 4 || stats.runs != 7)
+    exit (1);
+
+  sigsegv_prot_unregister (ticket);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
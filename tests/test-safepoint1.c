@@ -0,0 +1,165 @@
+/* Test the safepoint polling page.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && HAVE_PTHREAD
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define NTHREADS 4
+#define ROUNDS 3
+
+static volatile char *poll_page;
+static volatile int stop;
+static volatile unsigned long iterations[NTHREADS];
+static volatile int handler_called;
+
+static void
+safepoint_handler (unsigned long long time_to_safepoint,
+                   stackoverflow_context_t context)
+{
+  handler_called = 1;
+}
+
+static void *
+mutator (void *arg)
+{
+  int i = (int) (long) arg;
+
+  while (!stop)
+    {
+      /* Poll.  */
+      (void) *poll_page;
+      iterations[i]++;
+    }
+  return NULL;
+}
+
+static void *
+waiter (void *arg)
+{
+  /* No thread parks.  Only a disarming ends the wait.  */
+  *(int *) arg = sigsegv_safepoint_wait (1);
+  return NULL;
+}
+
+/* Waits until every mutator has made progress since SNAPSHOT was taken.  */
+static void
+wait_for_progress (unsigned long snapshot[NTHREADS])
+{
+  int i;
+
+  for (i = 0; i < NTHREADS; i++)
+    while (iterations[i] == snapshot[i])
+      usleep (1000);
+}
+
+int
+main ()
+{
+  pthread_t threads[NTHREADS];
+  unsigned long snapshot[NTHREADS];
+  sigsegv_safepoint_stats stats;
+  pthread_t waiter_thread;
+  int waiter_result;
+  int round;
+  int i;
+
+  poll_page = (volatile char *) sigsegv_safepoint_install (&safepoint_handler);
+  if (poll_page == NULL)
+    return 77;
+
+  /* A poll of the disarmed safepoint does nothing.  */
+  (void) *poll_page;
+
+  for (i = 0; i < NTHREADS; i++)
+    {
+      snapshot[i] = 0;
+      if (pthread_create (&threads[i], NULL, mutator, (void *) (long) i) != 0)
+        exit (2);
+    }
+  wait_for_progress (snapshot);
+
+  for (round = 0; round < ROUNDS; round++)
+    {
+      if (sigsegv_safepoint_arm () < 0)
+        exit (1);
+      if (sigsegv_safepoint_wait (NTHREADS) < 0)
+        exit (1);
+      if (sigsegv_safepoint_parked_count () != NTHREADS)
+        exit (1);
+
+      /* All mutators are halted.  */
+      for (i = 0; i < NTHREADS; i++)
+        snapshot[i] = iterations[i];
+      usleep (10000);
+      for (i = 0; i < NTHREADS; i++)
+        if (iterations[i] != snapshot[i])
+          exit (1);
+
+      if (sigsegv_safepoint_disarm () < 0)
+        exit (1);
+      wait_for_progress (snapshot);
+    }
+
+  stop = 1;
+  for (i = 0; i < NTHREADS; i++)
+    pthread_join (threads[i], NULL);
+
+  if (!handler_called)
+    exit (1);
+  sigsegv_safepoint_get_stats (&stats);
+  if (stats.parks != NTHREADS * ROUNDS)
+    exit (1);
+  if (stats.max_time * stats.parks < stats.total_time)
+    exit (1);
+
+  /* A disarming ends a wait from another thread.  */
+  if (sigsegv_safepoint_arm () < 0)
+    exit (1);
+  waiter_result = 0;
+  if (pthread_create (&waiter_thread, NULL, waiter, &waiter_result) != 0)
+    exit (2);
+  usleep (10000);
+  if (sigsegv_safepoint_disarm () < 0)
+    exit (1);
+  pthread_join (waiter_thread, NULL);
+  if (waiter_result != -1)
+    exit (1);
+
+  sigsegv_safepoint_deinstall ();
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,129 @@
+/* Test the SIGSEGV_AREA_SINGLESTEP flag.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+
+static sigsegv_dispatcher dispatcher;
+
+static volatile unsigned int area1_count = 0;
+static volatile unsigned int area2_count = 0;
+
+static int
+area_handler (void *fault_address, void *user_arg)
+{
+  volatile unsigned int *countp = (volatile unsigned int *) user_arg;
+  (*countp)++;
+  return 1;
+}
+
+static int
+handler (void *fault_address, int serious)
+{
+  return sigsegv_dispatch (&dispatcher, fault_address);
+}
+
+int
+main ()
+{
+  void *p;
+  uintptr_t area1;
+  uintptr_t area2;
+  volatile int *q;
+  int sum;
+  int i;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  sigsegv_init (&dispatcher);
+  sigsegv_install_handler (&handler);
+
+  /* Setup some mmapped memory.  */
+  p = mmap_zeromap ((void *) 0x12340000, 0x8000);
+  if (p == (void *)(-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  area1 = (uintptr_t) p;
+  area2 = (uintptr_t) p + 0x4000;
+  if (mprotect ((void *) area1, 0x4000, PROT_NONE) < 0
+      || mprotect ((void *) area2, 0x4000, PROT_READ) < 0)
+    {
+      fprintf (stderr, "mprotect failed.\n");
+      exit (2);
+    }
+
+  if (sigsegv_register_flags (&dispatcher, (void *) area1, 0x4000,
+                              &area_handler, (void *) &area1_count,
+                              SIGSEGV_AREA_SINGLESTEP)
+      == NULL)
+    return 77;
+  if (sigsegv_register_flags (&dispatcher, (void *) area2, 0x4000,
+                              &area_handler, (void *) &area2_count,
+                              SIGSEGV_AREA_SINGLESTEP | SIGSEGV_AREA_READONLY)
+      == NULL)
+    exit (1);
+
+  /* Every access to area1 is caught.  */
+  q = (volatile int *) (area1 + 0x100);
+  for (i = 0; i < 10; i++)
+    q[i] = i;
+  sum = 0;
+  for (i = 0; i < 10; i++)
+    sum += q[i];
+  if (sum != 45)
+    exit (1);
+  if (area1_count != 20)
+    exit (1);
+
+  /* Only writes to area2 are caught.  */
+  q = (volatile int *) (area2 + 0x2000);
+  for (i = 0; i < 10; i++)
+    q[i] = 2 * i;
+  sum = 0;
+  for (i = 0; i < 10; i++)
+    sum += q[i];
+  if (sum != 90)
+    exit (1);
+  if (area2_count != 10)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
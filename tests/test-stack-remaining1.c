@@ -0,0 +1,159 @@
+/* Test sigsegv_stack_remaining.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_PTHREAD && HAVE_MAKECONTEXT
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include "mmap-anon-util.h"
+
+#define THREAD_STACK_SIZE 0x40000 /* 256 KB */
+#define FIBER_STACK_SIZE 0x40000 /* 256 KB */
+#define RESERVE 0x8000
+
+static ucontext_t main_context;
+static ucontext_t fiber_context;
+static void *fiber_ticket;
+static volatile int failed;
+
+/* Recurses as long as more than RESERVE bytes of stack remain, like an
+   interpreter that checks the stack depth on each call.  Returns the
+   depth.  */
+static int
+recurse (int n)
+{
+  volatile char frame[256];
+
+  frame[0] = (char) n;
+  if (sigsegv_stack_remaining () < RESERVE)
+    return n;
+  return recurse (n + 1) + frame[0] - frame[0];
+}
+
+static void *
+thread_main (void *arg)
+{
+  size_t remaining;
+
+  if (stackoverflow_register_thread (NULL, 0) < 0)
+    {
+      failed = 77;
+      return NULL;
+    }
+  remaining = sigsegv_stack_remaining ();
+  if (!(remaining > 0 && remaining < THREAD_STACK_SIZE))
+    {
+      printf ("thread: %lu bytes remaining\n", (unsigned long) remaining);
+      failed = 1;
+      return NULL;
+    }
+  /* Without the check, this recursion would overflow the stack.  */
+  if (recurse (0) < 100)
+    failed = 1;
+  stackoverflow_unregister_thread ();
+  return NULL;
+}
+
+static void
+fiber (void)
+{
+  size_t remaining;
+
+  sigsegv_enter_stack (fiber_ticket);
+  remaining = sigsegv_stack_remaining ();
+  if (!(remaining > 0 && remaining < FIBER_STACK_SIZE))
+    {
+      printf ("fiber: %lu bytes remaining\n", (unsigned long) remaining);
+      failed = 1;
+    }
+  else if (recurse (0) < 100)
+    failed = 1;
+}
+
+int
+main ()
+{
+  pthread_t thread;
+  pthread_attr_t attr;
+  size_t remaining;
+  char *region;
+
+  if (stackoverflow_install_handler (NULL, NULL, 0) < 0)
+    exit (77);
+
+  /* The main thread.  */
+  remaining = sigsegv_stack_remaining ();
+  if (remaining == 0)
+    exit (1);
+
+  /* A registered thread.  */
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr, THREAD_STACK_SIZE);
+  if (pthread_create (&thread, &attr, thread_main, NULL) != 0)
+    exit (2);
+  pthread_join (thread, NULL);
+  pthread_attr_destroy (&attr);
+  if (failed)
+    exit (failed);
+
+  /* A fiber.  */
+  region = (char *) mmap_zeromap ((void *) 0, RESERVE + FIBER_STACK_SIZE);
+  if (region == (char *) (-1))
+    exit (2);
+  if (mprotect (region, RESERVE, PROT_NONE) < 0)
+    exit (2);
+  fiber_ticket = sigsegv_register_stack (region + RESERVE,
+                                         region + RESERVE + FIBER_STACK_SIZE,
+                                         RESERVE);
+  if (fiber_ticket == NULL)
+    exit (77);
+  if (getcontext (&fiber_context) < 0)
+    exit (2);
+  fiber_context.uc_stack.ss_sp = region + RESERVE;
+  fiber_context.uc_stack.ss_size = FIBER_STACK_SIZE;
+  fiber_context.uc_link = &main_context;
+  makecontext (&fiber_context, fiber, 0);
+  swapcontext (&main_context, &fiber_context);
+  sigsegv_enter_stack (NULL);
+  if (failed)
+    exit (failed);
+  sigsegv_unregister_stack (fiber_ticket);
+
+  /* Back on the main stack.  */
+  if (sigsegv_stack_remaining () < remaining - RESERVE)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,119 @@
+/* Test the stack high-water mark and stack trimming.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_PTHREAD
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define THREAD_STACK_SIZE 0x800000 /* 8 MB */
+#define USED_SIZE 0x100000 /* 1 MB */
+#define FRAME_SIZE 0x4000
+
+/* Uses about DEPTH * FRAME_SIZE bytes of stack.  */
+static int
+use_stack (int depth)
+{
+  volatile char frame[FRAME_SIZE];
+
+  memset ((char *) frame, depth, FRAME_SIZE);
+  if (depth > 1)
+    return use_stack (depth - 1) + frame[FRAME_SIZE / 2];
+  return frame[0];
+}
+
+/* Returns 1 if the stack usage of the calling thread is measured and
+   trimmed as expected, 0 if not, or 77 if not supported.  */
+static int
+check (void)
+{
+  size_t before;
+  size_t deep;
+  size_t after;
+
+  before = sigsegv_stack_high_water ();
+  if (before == 0)
+    return 77;
+  use_stack (USED_SIZE / FRAME_SIZE);
+  deep = sigsegv_stack_high_water ();
+  if (!(deep >= USED_SIZE && deep >= before))
+    {
+      printf ("high-water mark %lu after a deep call\n", (unsigned long) deep);
+      return 0;
+    }
+  if (sigsegv_stack_trim () < 0)
+    return 77;
+  after = sigsegv_stack_high_water ();
+  if (!(after < deep - USED_SIZE / 2))
+    {
+      printf ("high-water mark %lu after trimming\n", (unsigned long) after);
+      return 0;
+    }
+  /* The trimmed stack can be used again.  */
+  use_stack (USED_SIZE / FRAME_SIZE);
+  if (sigsegv_stack_high_water () < USED_SIZE)
+    return 0;
+  return 1;
+}
+
+static void *
+thread_main (void *arg)
+{
+  return (void *) (long) check ();
+}
+
+int
+main ()
+{
+  pthread_t thread;
+  pthread_attr_t attr;
+  void *result;
+  int ret;
+
+  ret = check ();
+  if (ret != 1)
+    exit (ret == 77 ? 77 : 1);
+
+  pthread_attr_init (&attr);
+  pthread_attr_setstacksize (&attr, THREAD_STACK_SIZE);
+  if (pthread_create (&thread, &attr, thread_main, NULL) != 0)
+    exit (2);
+  pthread_join (thread, &result);
+  pthread_attr_destroy (&attr);
+  if ((long) result != 1)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
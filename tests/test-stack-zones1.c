@@ -0,0 +1,226 @@
+/* Test the yellow and red zones of registered stacks.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+#include <limits.h>
+
+/* Skip this test when an address sanitizer is in use.  */
+#ifndef __has_feature
+# define __has_feature(a) 0
+#endif
+#if defined __SANITIZE_ADDRESS__ || __has_feature (address_sanitizer)
+# undef HAVE_STACK_OVERFLOW_RECOVERY
+#endif
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_SIGSEGV_RECOVERY && HAVE_MAKECONTEXT && STACK_DIRECTION < 0
+
+#include <stdlib.h>
+#include <signal.h>
+#include <setjmp.h>
+#include <ucontext.h>
+#if HAVE_SETRLIMIT
+# include <sys/types.h>
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+#include "mmap-anon-util.h"
+
+#define RED_SIZE 0x4000
+#define YELLOW_SIZE 0x8000
+#define FIBER_STACK_SIZE 0x40000
+#define ROUNDS 3
+
+static jmp_buf mainloop;
+static sigset_t mainsigset;
+static ucontext_t main_context;
+static ucontext_t fiber_context;
+
+static void *ticket;
+
+/* Set by the yellow zone handler.  */
+static volatile int yellow_pending;
+static volatile int yellow_hits;
+/* Whether the recursion stops when the yellow zone is hit.  */
+static volatile int honor_yellow;
+/* Set if the yellow zone could be protected too early.  */
+static volatile int early_reguard;
+/* The number of recursions that unwound without siglongjmp.  */
+static volatile int unwound;
+
+static void
+yellow_handler (void *stack, stackoverflow_context_t scp)
+{
+  if (stack == ticket)
+    {
+      yellow_hits++;
+      yellow_pending = 1;
+    }
+}
+
+static void
+stackoverflow_handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  int arg = (int) (long) arg1;
+  longjmp (mainloop, arg);
+}
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+  int result;
+
+  if (emergency)
+    result = -1;
+  else
+    result = (stackoverflow_overflowed_stack () == ticket ? 1 : -2);
+  sigprocmask (SIG_SETMASK, &mainsigset, NULL);
+  sigsegv_leave_handler (stackoverflow_handler_continuation,
+                         (void *) (long) result, NULL, NULL);
+}
+
+static int
+recurse (int n)
+{
+  volatile char frame[64];
+
+  frame[0] = (char) n;
+  if (honor_yellow && yellow_pending)
+    {
+      /* Unwind, like an exception would.  We are still in the yellow zone,
+         therefore it cannot be protected yet.  */
+      if (sigsegv_stack_reguard (ticket) == 0)
+        early_reguard = 1;
+      return n;
+    }
+  return recurse (n + 1) + frame[0];
+}
+
+static void
+fiber (void)
+{
+  int round;
+
+  honor_yellow = 1;
+  for (round = 0; round < ROUNDS; round++)
+    {
+      recurse (0);
+      yellow_pending = 0;
+      if (sigsegv_stack_reguard (ticket) < 0)
+        return;
+      unwound++;
+    }
+  /* Now ignore the yellow zone, and run into the red zone.  */
+  honor_yellow = 0;
+  recurse (0);
+}
+
+int
+main ()
+{
+  char *region;
+  char *stack;
+  sigset_t emptyset;
+
+#if HAVE_SETRLIMIT && defined RLIMIT_STACK
+  /* Before starting the endless recursion, try to be friendly to the user's
+     machine.  */
+  struct rlimit rl;
+  rl.rlim_cur = rl.rlim_max = 0x100000; /* 1 MB */
+  setrlimit (RLIMIT_STACK, &rl);
+#endif
+
+  /* Install the stack overflow handler.  */
+  if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0) < 0)
+    exit (2);
+
+  /* Allocate the fiber stack, with room for the zones below it.  */
+  region = (char *) mmap_zeromap ((void *) 0,
+                                  RED_SIZE + YELLOW_SIZE + FIBER_STACK_SIZE);
+  if (region == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  stack = region + RED_SIZE + YELLOW_SIZE;
+  ticket = sigsegv_register_stack_zones (stack, stack + FIBER_STACK_SIZE,
+                                         YELLOW_SIZE, RED_SIZE,
+                                         &yellow_handler);
+  if (ticket == NULL)
+    exit (77);
+
+  /* Save the current signal mask.  */
+  sigemptyset (&emptyset);
+  sigprocmask (SIG_BLOCK, &emptyset, &mainsigset);
+
+  switch (setjmp (mainloop))
+    {
+    case 0:
+      if (getcontext (&fiber_context) < 0)
+        exit (2);
+      fiber_context.uc_stack.ss_sp = stack;
+      fiber_context.uc_stack.ss_size = FIBER_STACK_SIZE;
+      fiber_context.uc_link = &main_context;
+      makecontext (&fiber_context, fiber, 0);
+      swapcontext (&main_context, &fiber_context);
+      printf ("no endless recursion?!\n"); exit (1);
+    case 1:
+      break;
+    case -1:
+      printf ("emergency exit\n"); exit (1);
+    default:
+      printf ("Stack overflow attributed to the wrong stack.\n");
+      exit (1);
+    }
+
+  if (unwound != ROUNDS)
+    {
+      printf ("The yellow zone could not be protected again.\n");
+      exit (1);
+    }
+  if (yellow_hits != ROUNDS + 1)
+    {
+      printf ("The yellow zone was hit %d times.\n", yellow_hits);
+      exit (1);
+    }
+  if (early_reguard)
+    {
+      printf ("The yellow zone was protected while in use.\n");
+      exit (1);
+    }
+
+  sigsegv_unregister_stack (ticket);
+  /* The zones are accessible again.  */
+  ((volatile char *) region)[0] = 1;
+  ((volatile char *) region)[RED_SIZE + YELLOW_SIZE - 1] = 1;
+
+  printf ("Test passed.\n");
+  exit (0);
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
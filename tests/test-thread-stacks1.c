@@ -0,0 +1,222 @@
+/* Test the stack ranges of the threads, for garbage collection.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdio.h>
+
+#if HAVE_STACK_OVERFLOW_RECOVERY && HAVE_PTHREAD
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define NTHREADS 4
+
+/* A parked thread has used little of its stack.  */
+#define MAX_PARKED_RANGE 0x10000
+
+/* The main thread's stack has grown little.  */
+#define MAX_MAIN_RANGE 0x100000
+
+/* The stack that each mutator uses before it polls.  */
+#define USED_SIZE 0x100000 /* 1 MB */
+#define FRAME_SIZE 0x4000
+
+static volatile char *poll_page;
+static volatile int stop;
+static volatile int registered;
+static pthread_mutex_t registered_lock = PTHREAD_MUTEX_INITIALIZER;
+/* The address of a local variable of each mutator.  */
+static char *volatile markers[NTHREADS];
+/* The address of a local variable of the main thread.  */
+static char *volatile main_marker;
+
+static void
+stackoverflow_handler (int emergency, stackoverflow_context_t scp)
+{
+}
+
+/* Returns nonzero if P lies in the range R.  */
+static int
+contains (const sigsegv_stack_range *r, void *p)
+{
+  return (char *) r->start <= (char *) p && (char *) p < (char *) r->end;
+}
+
+/* Uses about DEPTH * FRAME_SIZE bytes of stack.  */
+static int
+use_stack (int depth)
+{
+  volatile char frame[FRAME_SIZE];
+
+  memset ((char *) frame, depth, FRAME_SIZE);
+  if (depth > 1)
+    return use_stack (depth - 1) + frame[FRAME_SIZE / 2];
+  return frame[0];
+}
+
+static void *
+mutator (void *arg)
+{
+  int i = (int) (long) arg;
+  char marker;
+
+  if (stackoverflow_register_thread (NULL, 0) < 0)
+    exit (2);
+  markers[i] = &marker;
+  use_stack (USED_SIZE / FRAME_SIZE);
+  if (i == 0)
+    {
+      /* The range of the main thread, which is running, is the part of its
+         stack that is mapped, not all that RLIMIT_STACK permits.  */
+      sigsegv_stack_range ranges[NTHREADS + 2];
+      unsigned int n = sigsegv_thread_stack_ranges (ranges, NTHREADS + 2);
+      unsigned int j;
+
+      for (j = 1; j < n && j < NTHREADS + 2; j++)
+        if (contains (&ranges[j], main_marker))
+          {
+            if (ranges[j].parked)
+              exit (1);
+            if ((char *) ranges[j].end - (char *) ranges[j].start
+                > MAX_MAIN_RANGE)
+              exit (1);
+          }
+    }
+  pthread_mutex_lock (&registered_lock);
+  registered++;
+  pthread_mutex_unlock (&registered_lock);
+  while (!stop)
+    /* Poll.  */
+    (void) *poll_page;
+  return NULL;
+}
+
+int
+main ()
+{
+  pthread_t threads[NTHREADS];
+  sigsegv_stack_range ranges[NTHREADS + 2];
+  char marker;
+  unsigned int n;
+  int i;
+
+  if (stackoverflow_install_handler (&stackoverflow_handler, NULL, 0) < 0)
+    return 77;
+  poll_page = (volatile char *) sigsegv_safepoint_install (NULL);
+  if (poll_page == NULL)
+    return 77;
+
+  /* Only the main thread is registered.  */
+  n = sigsegv_thread_stack_ranges (ranges, NTHREADS + 2);
+  if (n == 0)
+    return 77;
+  if (n != 1)
+    exit (1);
+  if (!contains (&ranges[0], &marker) || ranges[0].parked)
+    exit (1);
+
+  main_marker = &marker;
+  for (i = 0; i < NTHREADS; i++)
+    if (pthread_create (&threads[i], NULL, mutator, (void *) (long) i) != 0)
+      exit (2);
+  while (registered < NTHREADS)
+    usleep (1000);
+
+  if (sigsegv_safepoint_arm () < 0)
+    exit (1);
+  if (sigsegv_safepoint_wait (NTHREADS) < 0)
+    exit (1);
+
+  n = sigsegv_thread_stack_ranges (ranges, NTHREADS + 2);
+  if (n != NTHREADS + 1)
+    exit (1);
+  if (!contains (&ranges[0], &marker) || ranges[0].parked)
+    exit (1);
+  /* Every mutator is parked, and its range is the used part of its stack.  */
+  for (i = 0; i < NTHREADS; i++)
+    {
+      unsigned int j;
+
+      for (j = 1; j < n; j++)
+        if (contains (&ranges[j], markers[i]))
+          break;
+      if (j == n)
+        exit (1);
+      if (!ranges[j].parked)
+        exit (1);
+      if ((char *) ranges[j].end - (char *) ranges[j].start > MAX_PARKED_RANGE)
+        exit (1);
+      if ((ranges[j].regs_start == NULL) != (ranges[j].regs_end == NULL))
+        exit (1);
+    }
+
+  /* The parked mutators have been deep, and can be trimmed.  */
+  {
+    size_t marks[NTHREADS + 2];
+    unsigned int j;
+
+    if (sigsegv_thread_stack_high_water (marks, NTHREADS + 2) != n)
+      exit (1);
+    if (marks[1] != 0)
+      {
+        for (j = 1; j < n; j++)
+          if (marks[j] < USED_SIZE)
+            exit (1);
+        if (sigsegv_thread_stack_trim () == NTHREADS)
+          {
+            sigsegv_thread_stack_high_water (marks, NTHREADS + 2);
+            for (j = 1; j < n; j++)
+              if (marks[j] >= USED_SIZE / 2)
+                exit (1);
+          }
+      }
+  }
+
+  /* The number of threads is returned even if there is no room.  */
+  if (sigsegv_thread_stack_ranges (ranges, 1) != NTHREADS + 1)
+    exit (1);
+
+  stop = 1;
+  if (sigsegv_safepoint_disarm () < 0)
+    exit (1);
+  for (i = 0; i < NTHREADS; i++)
+    pthread_join (threads[i], NULL);
+
+  /* The threads were unregistered when they exited.  */
+  if (sigsegv_thread_stack_ranges (ranges, NTHREADS + 2) != 1)
+    exit (1);
+
+  sigsegv_safepoint_deinstall ();
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
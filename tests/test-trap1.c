@@ -0,0 +1,149 @@
+/* Test the trap handlers.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && defined __GNUC__ && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include <stdlib.h> /* for abort, exit */
+#include <signal.h>
+#include <setjmp.h>
+
+/* An upper bound for the code size of the functions below.  */
+#define CODE_SIZE 0x100
+
+jmp_buf mainloop;
+sigset_t mainsigset;
+
+volatile int pass = 0;
+volatile int expected_sig;
+volatile int handler_called = 0;
+volatile int one = 1;
+volatile int zero = 0;
+volatile int result;
+
+static void
+handler_continuation (void *arg1, void *arg2, void *arg3)
+{
+  longjmp (mainloop, pass);
+}
+
+static int
+handler (int sig, int code, void *pc, void *user_arg,
+         stackoverflow_context_t context)
+{
+  uintptr_t start = (uintptr_t) user_arg;
+
+  handler_called++;
+  if (handler_called > 10)
+    abort ();
+  if (!((uintptr_t) pc >= start && (uintptr_t) pc - start < CODE_SIZE))
+    abort ();
+  if (expected_sig == SIGFPE)
+    {
+      if (sig != SIGFPE)
+        abort ();
+    }
+  else
+    {
+      /* Depending on the CPU, __builtin_trap() is an illegal instruction
+         or a breakpoint.  */
+      if (sig != SIGILL && sig != SIGTRAP)
+        abort ();
+    }
+  pass++;
+  printf ("Trap %d caught.\n", pass);
+  sigprocmask (SIG_SETMASK, &mainsigset, NULL);
+  return sigsegv_leave_handler (handler_continuation, NULL, NULL, NULL);
+}
+
+static void __attribute__ ((__noinline__))
+trapper (void)
+{
+  __builtin_trap ();
+}
+
+static void __attribute__ ((__noinline__))
+divider (void)
+{
+  result = one / zero;
+}
+
+int
+main ()
+{
+  void *ticket;
+  sigset_t emptyset;
+
+  ticket = sigsegv_register_trap ((void *) &trapper, CODE_SIZE,
+                                  &handler, (void *) &trapper);
+  if (ticket == NULL)
+    return 77;
+#if defined __i386__ || defined __x86_64__
+  /* Integer division by zero traps only on some CPUs.  */
+  if (sigsegv_register_trap ((void *) &divider, CODE_SIZE,
+                             &handler, (void *) &divider)
+      == NULL)
+    exit (2);
+#endif
+
+  /* Save the current signal mask.  */
+  sigemptyset (&emptyset);
+  sigprocmask (SIG_BLOCK, &emptyset, &mainsigset);
+
+  /* Provoke two traps in a row, then an arithmetic exception.  */
+  switch (setjmp (mainloop))
+    {
+    case 0: case 1:
+      printf ("Doing trap pass %d.\n", pass + 1);
+      expected_sig = SIGILL;
+      trapper ();
+      printf ("no trap?!\n"); exit (1);
+    case 2:
+#if defined __i386__ || defined __x86_64__
+      printf ("Doing trap pass %d.\n", pass + 1);
+      expected_sig = SIGFPE;
+      divider ();
+      printf ("no SIGFPE?!\n"); exit (1);
+#endif
+    case 3:
+      break;
+    default:
+      abort ();
+    }
+
+  sigsegv_unregister_trap (ticket);
+
+  /* Test passed!  */
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
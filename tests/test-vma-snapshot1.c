@@ -0,0 +1,149 @@
+/* Test the snapshot of the virtual memory areas.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_STACKVMA && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/* The size by which the main stack is grown.  */
+#define GROW_SIZE 0x100000
+
+/* Uses GROW_SIZE bytes of the stack and returns their address.  */
+static uintptr_t __attribute__ ((noinline))
+grow_stack (void)
+{
+  volatile char frame[GROW_SIZE];
+  size_t i;
+
+  for (i = 0; i < GROW_SIZE; i += 0x1000)
+    frame[i] = 1;
+  frame[GROW_SIZE - 1] = 1;
+  return (uintptr_t) &frame[0];
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  sigsegv_vma vma;
+  char marker;
+  char *p;
+  char *poll_page;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+
+  if (sigsegv_vma_snapshot_enable (1) < 0)
+    return 77;
+
+  if (sigsegv_vma_query (&marker, &vma, NULL, 0) != 0)
+    exit (1);
+  if (!((char *) vma.start <= &marker && &marker < (char *) vma.end))
+    exit (1);
+  if (!(vma.prot & SIGSEGV_VMA_WRITE) || vma.name != NULL)
+    exit (1);
+
+  /* The main stack is seen with the size it has grown to.  */
+  {
+    char *frame = (char *) grow_stack ();
+    char *low = (frame < &marker ? frame : &marker);
+    char *high = (frame < &marker ? &marker : frame + GROW_SIZE - 1);
+
+    if (sigsegv_vma_query (&marker, &vma, NULL, 0) != 0)
+      exit (1);
+    if (!((char *) vma.start <= low && high < (char *) vma.end))
+      exit (1);
+  }
+
+  /* An area that was mapped after the snapshot is found.  */
+  p = (char *) mmap_zeromap ((void *) 0, 5 * pagesize);
+  if (p == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  if (munmap (p, pagesize) < 0 || munmap (p + 4 * pagesize, pagesize) < 0)
+    exit (2);
+  if (sigsegv_vma_query (p + 2 * pagesize, &vma, NULL, 0) != 0)
+    exit (1);
+  if (vma.start != p + pagesize || vma.end != p + 4 * pagesize)
+    exit (1);
+
+  /* After an invalidation, changes of the protection are seen.  */
+  if (mprotect (p + 2 * pagesize, pagesize, PROT_READ) < 0)
+    exit (2);
+  sigsegv_vma_snapshot_invalidate ();
+  if (sigsegv_vma_query (p + 2 * pagesize, &vma, NULL, 0) != 0)
+    exit (1);
+  if (vma.start != p + 2 * pagesize || vma.end != p + 3 * pagesize
+      || vma.prot != SIGSEGV_VMA_READ)
+    exit (1);
+
+  /* After an invalidation, unmapped areas are gone.  */
+  if (munmap (p + pagesize, 3 * pagesize) < 0)
+    exit (2);
+  sigsegv_vma_snapshot_invalidate ();
+  if (sigsegv_vma_query (p + 2 * pagesize, &vma, NULL, 0) != 1)
+    exit (1);
+
+  /* Changes that libsigsegv makes itself are seen without invalidation.  */
+  poll_page = (char *) sigsegv_safepoint_install (NULL);
+  if (poll_page != NULL)
+    {
+      if (sigsegv_vma_query (poll_page, &vma, NULL, 0) != 0
+          || vma.prot != SIGSEGV_VMA_READ)
+        exit (1);
+      if (sigsegv_safepoint_arm () < 0)
+        exit (1);
+      if (sigsegv_vma_query (poll_page, &vma, NULL, 0) != 0
+          || vma.prot != 0)
+        exit (1);
+      if (sigsegv_safepoint_disarm () < 0)
+        exit (1);
+      sigsegv_safepoint_deinstall ();
+    }
+
+  /* Without the snapshot, the system is inquired.  */
+  if (sigsegv_vma_snapshot_enable (0) < 0)
+    exit (1);
+  if (sigsegv_vma_query (&marker, &vma, NULL, 0) != 0)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,166 @@
+/* Test the inquiry of the virtual memory areas.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_STACKVMA && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct iteration
+{
+  uintptr_t last_end;
+  unsigned int count;
+  int ordered;
+  /* The area that the iteration must find.  */
+  uintptr_t start;
+  uintptr_t end;
+  int found;
+};
+
+static int
+check_vma (void *user_arg, const sigsegv_vma *vma)
+{
+  struct iteration *it = (struct iteration *) user_arg;
+
+  if ((uintptr_t) vma->start < it->last_end
+      || (vma->end != NULL && (uintptr_t) vma->end <= (uintptr_t) vma->start))
+    it->ordered = 0;
+  it->last_end = (uintptr_t) vma->end;
+  it->count++;
+  if ((uintptr_t) vma->start == it->start && (uintptr_t) vma->end == it->end
+      && vma->prot == SIGSEGV_VMA_READ && vma->name != NULL
+      && vma->name[0] == '\0')
+    it->found = 1;
+  return 0;
+}
+
+static int
+stop_at_first (void *user_arg, const sigsegv_vma *vma)
+{
+  (*(unsigned int *) user_arg)++;
+  return 1;
+}
+
+int
+main ()
+{
+  size_t pagesize = getpagesize ();
+  char name[256];
+  char small_name[4];
+  sigsegv_vma vma;
+  struct iteration it;
+  unsigned int calls;
+  char marker;
+  char *p;
+  int ret;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+
+  ret = sigsegv_vma_query (&marker, &vma, name, sizeof (name));
+  if (ret < 0)
+    return 77;
+
+  /* The stack is readable and writable.  */
+  if (ret != 0)
+    exit (1);
+  if (!((char *) vma.start <= &marker && &marker < (char *) vma.end))
+    exit (1);
+  if ((vma.prot & (SIGSEGV_VMA_READ | SIGSEGV_VMA_WRITE))
+      != (SIGSEGV_VMA_READ | SIGSEGV_VMA_WRITE))
+    exit (1);
+  if (vma.name != name)
+    exit (1);
+#if defined __linux__
+  if (strcmp (name, "[stack]") != 0)
+    exit (1);
+  /* A name that does not fit is truncated.  */
+  if (sigsegv_vma_query (&marker, &vma, small_name, sizeof (small_name)) != 0)
+    exit (1);
+  if (strcmp (small_name, "[st") != 0)
+    exit (1);
+#endif
+  /* Names are optional.  */
+  if (sigsegv_vma_query (&marker, &vma, NULL, 0) != 0)
+    exit (1);
+  if (vma.name != NULL)
+    exit (1);
+
+  /* Set up an anonymous mapping with a read-only part, between two unmapped
+     pages.  */
+  p = (char *) mmap_zeromap ((void *) 0, 6 * pagesize);
+  if (p == (char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  if (munmap (p, pagesize) < 0 || munmap (p + 5 * pagesize, pagesize) < 0)
+    exit (2);
+  if (mprotect (p + 2 * pagesize, 2 * pagesize, PROT_READ) < 0)
+    exit (2);
+
+  if (sigsegv_vma_query (p + 3 * pagesize, &vma, name, sizeof (name)) != 0)
+    exit (1);
+  if (vma.start != p + 2 * pagesize || vma.end != p + 4 * pagesize)
+    exit (1);
+  if (vma.prot != SIGSEGV_VMA_READ || name[0] != '\0')
+    exit (1);
+  /* The unmapped page is not in any area.  */
+  if (sigsegv_vma_query (p, &vma, NULL, 0) != 1)
+    exit (1);
+
+  /* The iteration returns the areas in ascending order.  */
+  memset (&it, 0, sizeof (it));
+  it.ordered = 1;
+  it.start = (uintptr_t) (p + 2 * pagesize);
+  it.end = (uintptr_t) (p + 4 * pagesize);
+  if (sigsegv_vma_iterate (check_vma, &it, name, sizeof (name)) != 0)
+    exit (1);
+  if (!it.ordered || !it.found || it.count < 3)
+    exit (1);
+
+  /* The iteration stops when the callback returns nonzero.  */
+  calls = 0;
+  if (sigsegv_vma_iterate (stop_at_first, &calls, NULL, 0) != 0)
+    exit (1);
+  if (calls != 1)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
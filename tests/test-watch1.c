@@ -0,0 +1,130 @@
+/* Test the data watchpoints.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+
+static volatile unsigned int hits[3];
+static volatile uintptr_t last_address;
+
+static void
+watch_handler (void *fault_address, int is_write, void *user_arg)
+{
+  hits[(int) (intptr_t) user_arg]++;
+  last_address = (uintptr_t) fault_address;
+}
+
+int
+main ()
+{
+  void *p;
+  uintptr_t page;
+  volatile int *a;
+  void *w0;
+  void *w1;
+  void *w2;
+  int sum;
+  int i;
+
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+
+  /* Setup some mmapped memory.  */
+  p = mmap_zeromap ((void *) 0x12340000, 0x4000);
+  if (p == (void *)(-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  page = (uintptr_t) p;
+  a = (volatile int *) (page + 0x1000);
+
+  /* Watch a[10..19] and a[15..24] for all accesses, and a[100] for writes
+     only.  The first two share a page with the third.  */
+  w0 = sigsegv_watch ((void *) &a[10], 10 * sizeof (int), 0,
+                      &watch_handler, (void *) 0);
+  if (w0 == NULL)
+    return 77;
+  w1 = sigsegv_watch ((void *) &a[15], 10 * sizeof (int), 0,
+                      &watch_handler, (void *) 1);
+  w2 = sigsegv_watch ((void *) &a[100], sizeof (int), SIGSEGV_WATCH_WRITE,
+                      &watch_handler, (void *) 2);
+  if (w1 == NULL || w2 == NULL)
+    exit (1);
+
+  /* Accesses to unwatched bytes of a watched page.  */
+  for (i = 0; i < 10; i++)
+    a[i] = i;
+  for (i = 30; i < 40; i++)
+    a[i] = i;
+  if (hits[0] != 0 || hits[1] != 0 || hits[2] != 0)
+    exit (1);
+
+  /* Accesses to watched bytes.  */
+  a[12] = 12;
+  if (hits[0] != 1 || hits[1] != 0 || last_address != (uintptr_t) &a[12])
+    exit (1);
+  a[17] = 17;
+  if (hits[0] != 2 || hits[1] != 1)
+    exit (1);
+  sum = a[12] + a[17] + a[22];
+  if (sum != 29)
+    exit (1);
+  if (hits[0] != 4 || hits[1] != 3)
+    exit (1);
+  a[100] = 100;
+  if (hits[2] != 1)
+    exit (1);
+
+  /* After removal, accesses to the formerly watched bytes are not caught,
+     but the remaining watchpoints still are.  */
+  sigsegv_unwatch (w0);
+  a[12] = 0;
+  a[18] = 0;
+  if (hits[0] != 4 || hits[1] != 4)
+    exit (1);
+  sigsegv_unwatch (w1);
+  sigsegv_unwatch (w2);
+  a[18] = 18;
+  a[100] = 0;
+  if (hits[1] != 4 || hits[2] != 1)
+    exit (1);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif
@@ -0,0 +1,163 @@
+/* Test the tracking of the pages that are written to.
+   Copyright (C) 2026  Free Software Foundation, Inc.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
+
+#ifndef _MSC_VER
+# include <config.h>
+#endif
+
+#include "sigsegv.h"
+#include <stdint.h>
+#include <stdio.h>
+
+#if HAVE_SIGSEGV_RECOVERY && !(defined _WIN32 && !defined __CYGWIN__)
+
+#include "mmap-anon-util.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/* More pages than fit in a word of the bitmap.  */
+#define NPAGES 200
+
+static sigsegv_dispatcher dispatcher;
+static size_t pagesize;
+static volatile char *p;
+
+/* The runs of dirty pages that the last collection returned, as page
+   indices.  */
+static unsigned int nruns;
+static size_t runs[8][2];
+
+static void
+record_run (void *start, size_t len, void *user_arg)
+{
+  if (nruns < 8)
+    {
+      runs[nruns][0] = ((char *) start - (char *) p) / pagesize;
+      runs[nruns][1] = runs[nruns][0] + len / pagesize;
+    }
+  nruns++;
+}
+
+static int
+handler (void *fault_address, int serious)
+{
+  return sigsegv_dispatch (&dispatcher, fault_address);
+}
+
+/* Tracks the writes to a fresh area, with the given flags.  */
+static void
+check_tracking (int flags)
+{
+  void *ticket;
+
+  p = (volatile char *) mmap_zeromap ((void *) 0, NPAGES * pagesize);
+  if (p == (volatile char *) (-1))
+    {
+      fprintf (stderr, "mmap_zeromap failed.\n");
+      exit (2);
+    }
+  p[3 * pagesize] = 7;
+  ticket = sigsegv_wtrack_register_flags (&dispatcher, (void *) p,
+                                          NPAGES * pagesize, flags);
+  if (ticket == NULL)
+    exit (1);
+  /* A flag that is not supported falls back to page protection.  */
+  if ((sigsegv_wtrack_get_flags (ticket) & ~flags) != 0)
+    exit (1);
+
+  /* Reads don't make pages dirty.  */
+  if (p[3 * pagesize] != 7)
+    exit (1);
+  if (sigsegv_wtrack_is_dirty (ticket, (void *) (p + 3 * pagesize)) != 0)
+    exit (1);
+
+  /* Writes do, including writes that cross a word of the bitmap.  */
+  p[1 * pagesize] = 1;
+  p[2 * pagesize + 10] = 2;
+  p[3 * pagesize] = 3;
+  p[63 * pagesize] = 4;
+  p[64 * pagesize] = 5;
+  p[64 * pagesize + 1] = 6;
+  p[199 * pagesize] = 7;
+  if (sigsegv_wtrack_is_dirty (ticket, (void *) (p + 2 * pagesize)) != 1
+      || sigsegv_wtrack_is_dirty (ticket, (void *) (p + 4 * pagesize)) != 0)
+    exit (1);
+  if (sigsegv_wtrack_is_dirty (ticket, (void *) (p + NPAGES * pagesize))
+      != -1)
+    exit (1);
+
+  nruns = 0;
+  if (sigsegv_wtrack_collect (ticket, record_run, NULL) != 6)
+    exit (1);
+  if (nruns != 3
+      || runs[0][0] != 1 || runs[0][1] != 4
+      || runs[1][0] != 63 || runs[1][1] != 65
+      || runs[2][0] != 199 || runs[2][1] != 200)
+    exit (1);
+  if (sigsegv_wtrack_is_dirty (ticket, (void *) (p + 2 * pagesize)) != 0)
+    exit (1);
+
+  /* The collected pages are tracked again.  */
+  p[2 * pagesize] = 8;
+  nruns = 0;
+  if (sigsegv_wtrack_collect (ticket, record_run, NULL) != 1)
+    exit (1);
+  if (nruns != 1 || runs[0][0] != 2 || runs[0][1] != 3)
+    exit (1);
+  if (sigsegv_wtrack_collect (ticket, NULL, NULL) != 0)
+    exit (1);
+
+  /* The values that were written are kept.  */
+  if (p[1 * pagesize] != 1 || p[2 * pagesize + 10] != 2
+      || p[2 * pagesize] != 8 || p[64 * pagesize + 1] != 6)
+    exit (1);
+
+  /* After unregistering, the area is writable without faults.  */
+  sigsegv_wtrack_unregister (ticket);
+  p[5 * pagesize] = 9;
+}
+
+int
+main ()
+{
+  /* Preparations.  */
+#if !HAVE_MMAP_ANON && !HAVE_MMAP_ANONYMOUS && HAVE_MMAP_DEVZERO
+  zero_fd = open ("/dev/zero", O_RDONLY, 0644);
+#endif
+  pagesize = getpagesize ();
+  sigsegv_init (&dispatcher);
+  if (sigsegv_install_handler (&handler) < 0)
+    return 77;
+  if (sigsegv_wtrack_register (&dispatcher, (void *) 0, 0) != NULL)
+    exit (1);
+
+  check_tracking (0);
+  check_tracking (SIGSEGV_WTRACK_SOFT_DIRTY);
+  check_tracking (SIGSEGV_WTRACK_USERFAULTFD);
+
+  printf ("Test passed.\n");
+  return 0;
+}
+
+#else
+
+int
+main ()
+{
+  return 77;
+}
+
+#endif